@@ -0,0 +1,152 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/engine/archetype.hpp"
+#include "../src/engine/ecs.hpp"
+
+/*
+ * Compares fat entity and archetype storages on structural changes, queries and memory,
+ * over entity counts from 1k to 1M. Times are per stored entity, or per call for singleton lookups.
+ */
+
+namespace {
+
+using clock_t = std::chrono::high_resolution_clock;
+
+struct Position {
+    engine::f32 x{0.0f};
+    engine::f32 y{0.0f};
+};
+
+struct Velocity {
+    engine::f32 x{1.0f};
+    engine::f32 y{1.0f};
+};
+
+struct Health {
+    engine::i32 value{100};
+};
+
+struct Tag {};
+
+struct Camera {
+    engine::f32 zoom{1.0f};
+};
+
+using Entity = engine::ecs::Entity<Position, Velocity, Health, Tag, Camera>;
+
+// every sparse_ratio-th entity is tagged
+constexpr size_t sparse_ratio = 10;
+constexpr size_t lookups      = 100'000;
+
+template <typename Body>
+engine::f64 measure(Body&& body, size_t repeats)
+{
+    body();
+
+    auto begin = clock_t::now();
+    for (size_t i = 0; i < repeats; ++i) {
+        body();
+    }
+    std::chrono::duration<engine::f64, std::nano> diff = clock_t::now() - begin;
+
+    return diff.count() / repeats;
+}
+
+void report(const std::string& name, engine::f64 value, engine::cstr unit)
+{
+    std::cout << std::fixed << std::setw(13) << value << " " << unit << " :\t" << name << std::endl;
+}
+
+template <typename Storage>
+void spawn(Storage& storage, size_t count)
+{
+    engine::ecs::EntityBuilder<Entity, Storage> builder(storage);
+
+    builder.create().template with<Camera>().build();
+
+    for (size_t i = 0; i < count; ++i) {
+        builder.create().template with<Position>().template with<Velocity>().template with<Health>();
+
+        if (i % sparse_ratio == 0) {
+            builder.template with<Tag>();
+        }
+
+        builder.build();
+    }
+}
+
+template <typename Storage>
+void run(engine::cstr storage_name, size_t count)
+{
+    std::string suffix = std::string(", ") + storage_name + ", " + std::to_string(count);
+    size_t repeats     = std::max<size_t>(1, 100'000 / count);
+
+    report("create and destroy" + suffix, measure([count]() {
+               Storage storage;
+               std::vector<engine::ecs::EntityId> ids;
+               ids.reserve(count);
+
+               for (size_t i = 0; i < count; ++i) {
+                   ids.push_back(storage.create());
+               }
+               storage.remove_many(ids);
+           }, repeats) / count, "ns");
+
+    report("EntityBuilder spawn" + suffix, measure([count]() {
+               Storage storage;
+               spawn(storage, count);
+           }, repeats) / count, "ns");
+
+    Storage storage;
+    spawn(storage, count);
+
+    report("dense iteration" + suffix, measure([&storage]() {
+               auto it = storage.template iterator<Position, const Velocity>();
+               while (it) {
+                   auto [position, velocity] = *it;
+                   position.x += velocity.x;
+                   position.y += velocity.y;
+                   ++it;
+               }
+           }, repeats) / count, "ns");
+
+    report("sparse iteration" + suffix, measure([&storage]() {
+               auto it = storage.template iterator<const Tag, Health>();
+               while (it) {
+                   auto [tag, health] = *it;
+                   health.value -= 1;
+                   ++it;
+               }
+           }, repeats) / count, "ns");
+
+    engine::f32 sink = 0.0f;
+    report("singleton get" + suffix, measure([&storage, &sink]() {
+               for (size_t i = 0; i < lookups; ++i) {
+                   auto [camera] = storage.template get<const Camera>();
+                   sink += camera.zoom;
+               }
+           }, 1) / lookups, "ns");
+
+    report("memory per entity" + suffix, engine::f64(storage.memory()) / storage.active(), "B");
+
+    if (sink < 0.0f) {
+        std::cout << sink << std::endl;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    for (size_t count : {1'000, 10'000, 100'000, 1'000'000}) {
+        run<engine::ecs::EntityStorage<Entity>>("entity storage", count);
+        run<engine::ecs::ArchetypeStorage<Entity>>("archetype storage", count);
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
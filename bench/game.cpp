@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "../src/engine/core.hpp"
+#include "../src/engine/profiling.hpp"
+#include "../src/game.hpp"
+
+/*
+ * Runs the game headless for a fixed number of frames per entity count and reports
+ * frames per second and the mean time of every profiled scope. Every run spawns that many
+ * moving sprites on top of the regular scene, they go through the fixed step, interpolation
+ * and the spatial index of the renderer.
+ *
+ * Usage: game_bench [frames] [entities...]
+ */
+
+namespace {
+
+constexpr engine::f32 step = 1.0f / 60.0f;
+
+void report(engine::cstr name, engine::f64 ms)
+{
+    std::cout << std::fixed << std::setw(13) << ms << " ms :\t" << name << std::endl;
+}
+
+void run(size_t frames, size_t entities)
+{
+    engine::u32 grid = static_cast<engine::u32>(impl::game_preferenses::grid_size);
+
+    engine::rptr<engine::AutomaticProfilerRegister> profiler = engine::AutomaticProfilerRegister::get();
+    profiler->budget(step);
+    profiler->reset();
+
+    engine::HeadlessRunner runner(std::make_unique<impl::Game>(1280, 720, grid, entities), frames, step);
+    runner.run();
+
+    auto scopes = profiler->stats();
+    std::sort(scopes.begin(), scopes.end(), [](auto& a, auto& b) { return a.second.mean < b.second.mean; });
+
+    std::cout << "Entities: " << entities << ", frames: " << runner.frames() << std::endl;
+    std::cout << std::fixed << std::setw(13) << runner.frames() / runner.elapsed() << " fps" << std::endl;
+
+    for (auto& [name, stats] : scopes) {
+        report(name, stats.mean * 1000.0);
+    }
+
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t frames                = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000;
+    std::vector<size_t> entities = {1'000, 10'000, 100'000};
+
+    if (argc > 2) {
+        entities.clear();
+        for (int i = 2; i < argc; ++i) {
+            entities.push_back(std::strtoull(argv[i], nullptr, 10));
+        }
+    }
+
+    for (size_t count : entities) {
+        run(frames, count);
+    }
+
+    return 0;
+}
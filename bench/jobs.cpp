@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "../src/engine/jobs.hpp"
+
+/*
+ * Compares engine::jobs against std::async on spawn overhead and on a chunked parallel loop
+ */
+
+namespace {
+
+using clock_t = std::chrono::high_resolution_clock;
+
+template <typename Body>
+engine::f64 measure(Body&& body, size_t repeats = 10)
+{
+    body();
+
+    auto begin = clock_t::now();
+    for (size_t i = 0; i < repeats; ++i) {
+        body();
+    }
+    std::chrono::duration<engine::f64> diff = clock_t::now() - begin;
+
+    return diff.count() * 1000.0 / repeats;
+}
+
+void report(engine::cstr name, engine::f64 ms)
+{
+    std::cout << std::fixed << std::setw(13) << ms << " ms :\t" << name << std::endl;
+}
+
+void work(std::vector<engine::f32>& data, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i) {
+        data[i] = std::sqrt(data[i] * data[i] + 1.0f);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    constexpr size_t tasks = 10'000;
+    constexpr size_t size  = 1 << 22;
+    constexpr size_t grain = 16 * 1024;
+
+    engine::jobs::Pool& pool = *engine::jobs::Pool::get();
+    std::vector<engine::f32> data(size, 1.0f);
+    std::atomic<size_t> sink{0};
+
+    std::cout << "Workers: " << pool.workers() << std::endl;
+
+    report("empty jobs, engine::jobs", measure([&]() {
+               engine::jobs::Counter counter;
+               for (size_t i = 0; i < tasks; ++i) {
+                   pool.submit([&sink]() { sink.fetch_add(1, std::memory_order_relaxed); }, &counter);
+               }
+               pool.wait(counter);
+           }));
+
+    report("empty jobs, std::async", measure([&]() {
+               std::vector<std::future<void>> futures;
+               futures.reserve(tasks);
+               for (size_t i = 0; i < tasks; ++i) {
+                   futures.push_back(std::async(std::launch::async, [&sink]() {
+                       sink.fetch_add(1, std::memory_order_relaxed);
+                   }));
+               }
+               for (auto& f : futures) {
+                   f.wait();
+               }
+           }));
+
+    report("loop, single thread", measure([&]() { work(data, 0, size); }));
+
+    report("loop, engine::jobs parallel_for", measure([&]() {
+               pool.parallel_for(0, size, grain, [&data](size_t begin, size_t end) { work(data, begin, end); });
+           }));
+
+    report("loop, std::async", measure([&]() {
+               std::vector<std::future<void>> futures;
+               for (size_t begin = 0; begin < size; begin += grain) {
+                   size_t end = std::min(size, begin + grain);
+                   futures.push_back(
+                       std::async(std::launch::async, [&data, begin, end]() { work(data, begin, end); }));
+               }
+               for (auto& f : futures) {
+                   f.wait();
+               }
+           }));
+
+    return 0;
+}
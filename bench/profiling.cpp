@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../src/engine/profiling.hpp"
+
+/*
+ * Measures overhead of a single PROFILE scope on one and on several threads. Scopes are recorded
+ * in batches that fit a thread buffer and collected in between outside of the measured time,
+ * so every record is stored and none takes the cheaper dropping path.
+ */
+
+namespace {
+
+using clock_t = std::chrono::high_resolution_clock;
+
+constexpr size_t iterations = 1'000'000;
+constexpr size_t batch      = engine::AutomaticProfilerBuffer::capacity / 2;
+
+volatile size_t sink = 0;
+
+void report(engine::cstr name, engine::f64 ns)
+{
+    std::cout << std::fixed << std::setw(13) << ns << " ns :\t" << name << std::endl;
+}
+
+engine::f64 empty()
+{
+    auto begin = clock_t::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        sink = sink + i;
+    }
+    std::chrono::duration<engine::f64, std::nano> diff = clock_t::now() - begin;
+
+    return diff.count() / iterations;
+}
+
+engine::f64 profiled()
+{
+    std::chrono::duration<engine::f64, std::nano> diff{0};
+
+    for (size_t from = 0; from < iterations; from += batch) {
+        size_t to = std::min(iterations, from + batch);
+
+        engine::AutomaticProfilerRegister::get()->collect();
+
+        auto begin = clock_t::now();
+        for (size_t i = from; i < to; ++i) {
+            PROFILE(bench_scope);
+            sink = sink + i;
+        }
+        diff += clock_t::now() - begin;
+    }
+
+    return diff.count() / iterations;
+}
+
+} // namespace
+
+int main()
+{
+    // warm up: register the thread buffer and start the collector
+    profiled();
+
+    engine::f64 base = empty();
+    engine::f64 cost = profiled();
+
+    report("loop body", base);
+    report("loop body with PROFILE, 1 thread", cost);
+    report("PROFILE overhead, 1 thread", cost - base);
+
+    size_t threads = std::max<size_t>(2, std::thread::hardware_concurrency());
+    std::vector<engine::f64> costs(threads);
+    std::vector<std::thread> workers;
+
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&costs, t]() { costs[t] = profiled(); });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    engine::f64 average = 0.0;
+    for (engine::f64 c : costs) {
+        average += c / threads;
+    }
+
+    std::cout << "Threads: " << threads << std::endl;
+    report("PROFILE overhead, all threads", average - base);
+
+    // dropped records are cheaper than stored ones and would understate the overhead
+    size_t dropped = engine::AutomaticProfilerRegister::get()->dropped();
+    std::cout << "Dropped records: " << dropped << std::endl;
+
+    if (dropped > 0) {
+        std::cerr << "Records were dropped, the overhead above is not reliable" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
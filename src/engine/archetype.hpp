@@ -0,0 +1,655 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstring>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "defines.hpp"
+#include "ecs.hpp"
+
+namespace engine::ecs {
+
+/*
+ * Archetype based storage: entities are grouped by component signature, every component
+ * of an archetype lives in its own tightly packed column inside fixed-size chunks.
+ * Rows are relocated with memcpy, so components have to be trivially copyable.
+ */
+template <typename Entity>
+class ArchetypeStorage;
+
+template <typename... Components>
+class ArchetypeStorage<Entity<Components...>> {
+    static constexpr size_t count_ = utils::Count<Components...>;
+    static constexpr auto sizes_   = utils::Sizes<Components...>;
+    static constexpr auto aligns_  = std::array<size_t, count_>{alignof(Components)...};
+    static constexpr size_t npos   = static_cast<size_t>(-1);
+
+    using signature_t = std::bitset<count_>;
+
+    template <typename Component>
+    static constexpr size_t index() noexcept
+    {
+        return utils::Index<std::remove_const_t<Component>, Components...>;
+    }
+
+    template <typename... RequaredComponents>
+    static signature_t signature() noexcept
+    {
+        signature_t result;
+        (result.set(index<RequaredComponents>()), ...);
+        return result;
+    }
+
+    struct Location {
+        size_t archetype{npos};
+        size_t row{0};
+        u32 generation{0};
+    };
+
+    /*
+     * Ticks of the last add and the last mutable access of a component
+     */
+    struct Ticks {
+        Tick added{0};
+        Tick changed{0};
+    };
+
+    /*
+     * Chunk layout: [ids | column 0 | ticks 0 | column 1 | ticks 1 | ...], rows are dense,
+     * every chunk except the last one is full
+     */
+    struct Archetype {
+        signature_t signature;
+        size_t capacity{0};
+        size_t bytes{0};
+        size_t size{0};
+        std::array<size_t, count_> offsets{};
+        std::array<size_t, count_> ticks{};
+        std::array<size_t, count_> edges{};
+        std::vector<uptr<byte[]>> chunks;
+    };
+
+public:
+    template <typename... RequaredComponents>
+    using ComponentsRefs = std::tuple<RequaredComponents&...>;
+
+    static constexpr size_t chunk_bytes = 16 * 1024;
+
+    static_assert((std::is_trivially_copyable_v<Components> && ...));
+    static_assert(((alignof(Components) <= alignof(std::max_align_t)) && ...));
+
+    ArchetypeStorage() noexcept
+    {
+        archetype(signature_t{});
+    }
+
+    EntityId create() noexcept
+    {
+        EntityId result;
+
+        if (dead_.size() > 0) {
+            result.index = dead_.back();
+            dead_.pop_back();
+        }
+        else {
+            result.index = locations_.size();
+            locations_.emplace_back();
+        }
+
+        Location& location = locations_[result.index];
+        result.generation  = location.generation;
+        location.archetype = 0;
+        location.row       = push(archetypes_[0], result);
+
+        return result;
+    }
+
+    size_t size() const noexcept
+    {
+        return locations_.size();
+    }
+
+    size_t active() const noexcept
+    {
+        return locations_.size() - dead_.size();
+    }
+
+    bool alive(EntityId i) const noexcept
+    {
+        return i.index < locations_.size() && locations_[i.index].generation == i.generation;
+    }
+
+    Tick tick() const noexcept
+    {
+        return tick_.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * Tick changes are stamped with: the one of the running system, the current one outside of systems
+     */
+    Tick write_tick() const noexcept
+    {
+        return detail::system_tick != 0 ? detail::system_tick : tick();
+    }
+
+    /*
+     * Starts a new tick, changes made from now on are newer than everything before
+     */
+    Tick advance() noexcept
+    {
+        return tick_.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    /*
+     * Bytes occupied by chunks, entity locations and free slots
+     */
+    size_t memory() const noexcept
+    {
+        size_t result = locations_.capacity() * sizeof(Location) + dead_.capacity() * sizeof(u32);
+
+        for (const Archetype& a : archetypes_) {
+            result += a.chunks.size() * a.bytes;
+        }
+
+        return result;
+    }
+
+    template <typename Component, typename... Args>
+    Component& add(EntityId i, Args... args) noexcept
+    {
+        assert(alive(i));
+
+        if (!archetypes_[locations_[i.index].archetype].signature.test(index<Component>())) {
+            move(i, transition(locations_[i.index].archetype, index<Component>()));
+        }
+
+        const Location& location = locations_[i.index];
+        Archetype& a             = archetypes_[location.archetype];
+        Component* component     = column<Component>(a, location.row);
+        new (component) Component(std::forward<Args>(args)...);
+
+        *ticks(a, index<Component>(), location.row) = Ticks{.added = write_tick(), .changed = write_tick()};
+
+        return *component;
+    }
+
+    /*
+     * Removing a dead or stale handle is a no-op
+     */
+    void remove(EntityId i) noexcept
+    {
+        if (!alive(i)) {
+            return;
+        }
+
+        removing(i, archetypes_[locations_[i.index].archetype].signature);
+
+        Location& location = locations_[i.index];
+        erase(location.archetype, location.row);
+        location.archetype = npos;
+        ++location.generation;
+        dead_.push_back(i.index);
+    }
+
+    /*
+     * Removes a batch grouped by archetype, rows of an archetype are erased from the highest
+     * down, so the last row swapped into a hole is never one that is still waiting to be erased
+     */
+    void remove_many(std::span<const EntityId> ids) noexcept
+    {
+        batch_.clear();
+
+        for (EntityId i : ids) {
+            if (alive(i)) {
+                removing(i, archetypes_[locations_[i.index].archetype].signature);
+
+                Location& location = locations_[i.index];
+                batch_.push_back(location);
+                dead_.push_back(i.index);
+
+                // dropping the location right away drops handles listed twice
+                location.archetype = npos;
+                ++location.generation;
+            }
+        }
+
+        std::sort(batch_.begin(), batch_.end(), [](const Location& a, const Location& b) {
+            return a.archetype != b.archetype ? a.archetype < b.archetype : a.row > b.row;
+        });
+
+        for (const Location& location : batch_) {
+            erase(location.archetype, location.row);
+        }
+    }
+
+    template <typename Component>
+    void remove(EntityId i) noexcept
+    {
+        if (alive(i) && archetypes_[locations_[i.index].archetype].signature.test(index<Component>())) {
+            removing(i, signature<Component>());
+            move(i, transition(locations_[i.index].archetype, index<Component>()));
+        }
+    }
+
+    /*
+     * Makes room for count more entities
+     */
+    void reserve(size_t count) noexcept
+    {
+        if (count > dead_.size()) {
+            locations_.reserve(locations_.size() + count - dead_.size());
+        }
+    }
+
+    template <typename... RequaredComponents>
+    class Iterator {
+    public:
+        Iterator(ArchetypeStorage& storage, const detail::TickFilters& filters = {}, size_t filters_count = 0) noexcept
+            : storage_(storage)
+            , signature_(ArchetypeStorage::signature<RequaredComponents...>())
+            , filters_(filters)
+            , filters_count_(filters_count)
+            , tick_(storage.write_tick())
+        {
+            // any-of filters do not require their components
+            for (size_t f = 0; f < filters_count_; ++f) {
+                if (!filters_[f].any) {
+                    signature_.set(filters_[f].component);
+                }
+            }
+
+            seek();
+
+            while (*this && !good()) {
+                step();
+            }
+        }
+
+        ComponentsRefs<RequaredComponents...> operator*() const noexcept
+        {
+            touch(std::index_sequence_for<RequaredComponents...>{});
+            return ComponentsRefs<RequaredComponents...>(std::get<RequaredComponents*>(columns_)[row_]...);
+        }
+
+        Iterator& operator++() noexcept
+        {
+            do {
+                step();
+            } while (*this && !good());
+
+            return *this;
+        }
+
+        operator bool() const noexcept
+        {
+            return archetype_ < storage_.archetypes_.size();
+        }
+
+        EntityId id() const noexcept
+        {
+            return ids_[row_];
+        }
+
+    private:
+        template <size_t... I>
+        void touch(std::index_sequence<I...>) const noexcept
+        {
+            ((std::is_const_v<RequaredComponents> ? void() : void(ticks_[I][row_].changed = tick_)), ...);
+        }
+
+        bool good() const noexcept
+        {
+            bool any  = false;
+            bool some = false;
+
+            for (size_t f = 0; f < filters_count_; ++f) {
+                const Ticks* ticks = filter_ticks_[f] ? &filter_ticks_[f][row_] : nullptr;
+                bool ok = ticks && (filters_[f].added ? ticks->added : ticks->changed) > filters_[f].since;
+
+                if (filters_[f].any) {
+                    any  = true;
+                    some = some || ok;
+                }
+                else if (!ok) {
+                    return false;
+                }
+            }
+
+            return !any || some;
+        }
+
+        void step() noexcept
+        {
+            if (++row_ == rows_) {
+                ++chunk_;
+                if (chunk_ < storage_.archetypes_[archetype_].chunks.size() &&
+                    chunk_ * storage_.archetypes_[archetype_].capacity < storage_.archetypes_[archetype_].size) {
+                    load();
+                }
+                else {
+                    ++archetype_;
+                    seek();
+                }
+            }
+        }
+
+        void seek() noexcept
+        {
+            while (archetype_ < storage_.archetypes_.size()) {
+                const Archetype& a = storage_.archetypes_[archetype_];
+
+                if (a.size > 0 && (a.signature & signature_) == signature_) {
+                    chunk_ = 0;
+                    load();
+                    return;
+                }
+
+                ++archetype_;
+            }
+        }
+
+        void load() noexcept
+        {
+            Archetype& a = storage_.archetypes_[archetype_];
+            byte* data   = a.chunks[chunk_].get();
+
+            row_     = 0;
+            rows_    = std::min(a.capacity, a.size - chunk_ * a.capacity);
+            ids_     = reinterpret_cast<EntityId*>(data);
+            columns_ = std::tuple<RequaredComponents*...>(
+                reinterpret_cast<RequaredComponents*>(data + a.offsets[index<RequaredComponents>()])...);
+            ticks_ = {reinterpret_cast<Ticks*>(data + a.ticks[index<RequaredComponents>()])...};
+
+            for (size_t f = 0; f < filters_count_; ++f) {
+                size_t component = filters_[f].component;
+                filter_ticks_[f] =
+                    a.signature.test(component) ? reinterpret_cast<Ticks*>(data + a.ticks[component]) : nullptr;
+            }
+        }
+
+        ArchetypeStorage& storage_;
+        signature_t signature_;
+        detail::TickFilters filters_;
+        size_t filters_count_{0};
+        Tick tick_{0};
+        size_t archetype_{0};
+        size_t chunk_{0};
+        size_t row_{0};
+        size_t rows_{0};
+        EntityId* ids_{nullptr};
+        std::tuple<RequaredComponents*...> columns_;
+        std::array<Ticks*, sizeof...(RequaredComponents)> ticks_{};
+        std::array<Ticks*, detail::max_filters> filter_ticks_{};
+    };
+
+    /*
+     * Optional Added<Component>, Changed<Component> and AnyChanged<Components...> filters narrow the query down
+     */
+    template <typename... RequaredComponents, typename... Filters>
+    Iterator<RequaredComponents...> iterator(Filters... filters) noexcept
+    {
+        static_assert((detail::filter_size<Filters> + ... + 0) <= detail::max_filters);
+
+        detail::FilterBuilder<ComponentIndex> builder;
+        (builder.add(filters), ...);
+
+        return Iterator<RequaredComponents...>(*this, builder.filters, builder.count);
+    }
+
+    /*
+     * Calls hook right before Component leaves an entity, removed on its own or with the entity.
+     * The component can still be read from the hook.
+     */
+    template <typename Component>
+    void on_remove(remove_hook_t hook) noexcept
+    {
+        hooks_[index<Component>()].push_back(std::move(hook));
+    }
+
+    /*
+     * Components of one entity, mutable access is recorded for change detection
+     */
+    template <typename... RequaredComponents>
+    ComponentsRefs<RequaredComponents...> get(EntityId i) noexcept
+    {
+        assert(alive(i));
+
+        const Location& location = locations_[i.index];
+        Archetype& a             = archetypes_[location.archetype];
+
+        (touch<RequaredComponents>(a, location.row, write_tick()), ...);
+        return ComponentsRefs<RequaredComponents...>(*column<RequaredComponents>(a, location.row)...);
+    }
+
+    template <typename... RequaredComponents>
+    std::tuple<RequaredComponents&...> get() noexcept
+    {
+        const signature_t required = signature<RequaredComponents...>();
+
+        for (Archetype& a : archetypes_) {
+            if (a.size > 0 && (a.signature & required) == required) {
+                (touch<RequaredComponents>(a, 0, write_tick()), ...);
+                return ComponentsRefs<RequaredComponents...>(*column<RequaredComponents>(a, 0)...);
+            }
+        }
+
+        assert(false);
+        __builtin_unreachable();
+    }
+
+    /*
+     * Calls body(components...) for every matching entity, every chunk of a matching
+     * archetype is a separate job, so each entity is visited by exactly one worker.
+     * Structural changes are not allowed until it returns.
+     */
+    template <typename... RequaredComponents, typename Body>
+    void parallel_for_each(Body&& body) noexcept
+    {
+        const signature_t required = signature<RequaredComponents...>();
+        const Tick now             = write_tick();
+
+        std::vector<std::pair<size_t, size_t>> chunks;
+        for (size_t a = 0; a < archetypes_.size(); ++a) {
+            if ((archetypes_[a].signature & required) == required) {
+                for (size_t c = 0; c * archetypes_[a].capacity < archetypes_[a].size; ++c) {
+                    chunks.emplace_back(a, c);
+                }
+            }
+        }
+
+        jobs::Pool::get()->parallel_for(0, chunks.size(), 1, [this, &chunks, &body, now](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                Archetype& a = archetypes_[chunks[k].first];
+                size_t first = chunks[k].second * a.capacity;
+                size_t rows  = std::min(a.capacity, a.size - first);
+
+                std::tuple<RequaredComponents*...> columns(column<RequaredComponents>(a, first)...);
+                for (size_t row = 0; row < rows; ++row) {
+                    (touch<RequaredComponents>(a, first + row, now), ...);
+                    body(std::get<RequaredComponents*>(columns)[row]...);
+                }
+            }
+        });
+    }
+
+private:
+    template <typename Component>
+    struct ComponentIndex : std::integral_constant<size_t, index<Component>()> {};
+
+    /*
+     * Runs remove hooks of the components in the signature
+     */
+    void removing(EntityId i, const signature_t& components) noexcept
+    {
+        for (size_t c = 0; c < count_; ++c) {
+            if (components.test(c)) {
+                for (const remove_hook_t& hook : hooks_[c]) {
+                    hook(i);
+                }
+            }
+        }
+    }
+
+    static size_t align(size_t offset, size_t alignment) noexcept
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    static size_t layout(Archetype& a, size_t capacity) noexcept
+    {
+        size_t offset = capacity * sizeof(EntityId);
+
+        for (size_t c = 0; c < count_; ++c) {
+            if (a.signature.test(c)) {
+                a.offsets[c] = align(offset, aligns_[c]);
+                a.ticks[c]   = align(a.offsets[c] + capacity * sizes_[c], alignof(Ticks));
+                offset       = a.ticks[c] + capacity * sizeof(Ticks);
+            }
+        }
+
+        return offset;
+    }
+
+    size_t archetype(signature_t signature) noexcept
+    {
+        if (auto it = index_.find(signature); it != index_.end()) {
+            return it->second;
+        }
+
+        Archetype a;
+        a.signature = signature;
+        a.edges.fill(npos);
+
+        size_t row = sizeof(EntityId);
+        for (size_t c = 0; c < count_; ++c) {
+            row += signature.test(c) ? sizes_[c] + sizeof(Ticks) : 0;
+        }
+
+        a.capacity = std::max<size_t>(1, chunk_bytes / row);
+        while (a.capacity > 1 && layout(a, a.capacity) > chunk_bytes) {
+            --a.capacity;
+        }
+        a.bytes = layout(a, a.capacity);
+
+        archetypes_.push_back(std::move(a));
+        index_.emplace(signature, archetypes_.size() - 1);
+
+        return archetypes_.size() - 1;
+    }
+
+    /*
+     * Archetype reached by adding the component if it is missing, or by removing it otherwise
+     */
+    size_t transition(size_t from, size_t component) noexcept
+    {
+        if (archetypes_[from].edges[component] == npos) {
+            size_t to                          = archetype(archetypes_[from].signature ^ signature_t().set(component));
+            archetypes_[from].edges[component] = to;
+        }
+
+        return archetypes_[from].edges[component];
+    }
+
+    static byte* at(Archetype& a, size_t component, size_t row) noexcept
+    {
+        return a.chunks[row / a.capacity].get() + a.offsets[component] + (row % a.capacity) * sizes_[component];
+    }
+
+    static EntityId& id(Archetype& a, size_t row) noexcept
+    {
+        return reinterpret_cast<EntityId*>(a.chunks[row / a.capacity].get())[row % a.capacity];
+    }
+
+    static Ticks* ticks(Archetype& a, size_t component, size_t row) noexcept
+    {
+        return reinterpret_cast<Ticks*>(a.chunks[row / a.capacity].get() + a.ticks[component]) + row % a.capacity;
+    }
+
+    template <typename Component>
+    static Component* column(Archetype& a, size_t row) noexcept
+    {
+        return reinterpret_cast<Component*>(at(a, index<Component>(), row));
+    }
+
+    /*
+     * Records mutable access to a component, const access is not tracked
+     */
+    template <typename Component>
+    static void touch(Archetype& a, size_t row, Tick tick) noexcept
+    {
+        if constexpr (!std::is_const_v<Component>) {
+            ticks(a, index<Component>(), row)->changed = tick;
+        }
+    }
+
+    static size_t push(Archetype& a, EntityId i) noexcept
+    {
+        if (a.size == a.chunks.size() * a.capacity) {
+            a.chunks.emplace_back(new byte[a.bytes]);
+        }
+
+        id(a, a.size) = i;
+        return a.size++;
+    }
+
+    void erase(size_t archetype, size_t row) noexcept
+    {
+        Archetype& a = archetypes_[archetype];
+        size_t last  = a.size - 1;
+
+        if (row != last) {
+            for (size_t c = 0; c < count_; ++c) {
+                if (a.signature.test(c)) {
+                    std::memcpy(at(a, c, row), at(a, c, last), sizes_[c]);
+                    *ticks(a, c, row) = *ticks(a, c, last);
+                }
+            }
+
+            id(a, row)                       = id(a, last);
+            locations_[id(a, row).index].row = row;
+        }
+
+        --a.size;
+
+        // keep one spare chunk around to avoid thrashing on the boundary
+        if (a.chunks.size() * a.capacity >= a.size + 2 * a.capacity) {
+            a.chunks.pop_back();
+        }
+    }
+
+    void move(EntityId i, size_t to) noexcept
+    {
+        Location from = locations_[i.index];
+        Archetype& s  = archetypes_[from.archetype];
+        Archetype& d  = archetypes_[to];
+        size_t row    = push(d, i);
+
+        for (size_t c = 0; c < count_; ++c) {
+            if (s.signature.test(c) && d.signature.test(c)) {
+                std::memcpy(at(d, c, row), at(s, c, from.row), sizes_[c]);
+                *ticks(d, c, row) = *ticks(s, c, from.row);
+            }
+        }
+
+        erase(from.archetype, from.row);
+        locations_[i.index] = Location{.archetype = to, .row = row, .generation = from.generation};
+    }
+
+    std::vector<Archetype> archetypes_;
+    std::unordered_map<signature_t, size_t> index_;
+    std::vector<Location> locations_;
+    std::vector<u32> dead_;
+    std::vector<Location> batch_;
+    std::array<std::vector<remove_hook_t>, count_> hooks_;
+    std::atomic<Tick> tick_{1};
+};
+
+} // namespace engine::ecs
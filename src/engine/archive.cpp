@@ -0,0 +1,233 @@
+#include "archive.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "names.hpp"
+
+namespace engine {
+
+namespace {
+
+constexpr u64 alignment = 16;
+
+string normalize(const string& relative)
+{
+    return std::filesystem::path(relative).lexically_normal().generic_string();
+}
+
+bool slurp(const std::filesystem::path& path, std::vector<byte>& bytes)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
+}
+
+} // namespace
+
+Blob::Blob(sptr<const Archive> archive, std::span<const byte> view) noexcept
+    : archive_(std::move(archive))
+    , view_(view)
+{
+}
+
+Blob::Blob(std::vector<byte> owned) noexcept
+    : owned_(std::move(owned))
+    , view_(owned_)
+{
+}
+
+const byte* Blob::data() const noexcept
+{
+    return view_.data();
+}
+
+size_t Blob::size() const noexcept
+{
+    return view_.size();
+}
+
+bool Blob::empty() const noexcept
+{
+    return view_.empty();
+}
+
+sptr<Archive> Archive::open(const string& path) noexcept
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t length = static_cast<size_t>(info.st_size);
+    void* map     = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the mapping keeps the file referenced on its own
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        return nullptr;
+    }
+
+    sptr<Archive> archive(new Archive());
+    archive->map_    = static_cast<const byte*>(map);
+    archive->length_ = length;
+
+    const Header* header = reinterpret_cast<const Header*>(archive->map_);
+    if (header->magic != magic || header->version != version ||
+        header->count > (length - sizeof(Header)) / sizeof(Entry)) {
+        return nullptr;
+    }
+
+    archive->index_ = std::span<const Entry>(
+        reinterpret_cast<const Entry*>(archive->map_ + sizeof(Header)), static_cast<size_t>(header->count));
+
+    for (const Entry& entry : archive->index_) {
+        if (entry.offset > length || entry.size > length - entry.offset) {
+            return nullptr;
+        }
+    }
+
+    return archive;
+}
+
+bool Archive::write(const string& root, const std::vector<string>& files, const string& path, bool compress) noexcept
+{
+    struct Item {
+        Entry entry;
+        std::vector<byte> bytes;
+    };
+
+    std::vector<Item> items;
+    items.reserve(files.size());
+
+    for (const string& file : files) {
+        Item item{};
+        if (!slurp(std::filesystem::path(root) / file, item.bytes)) {
+            return false;
+        }
+
+        item.entry.hash        = hash(normalize(file));
+        item.entry.raw         = item.bytes.size();
+        item.entry.compression = Compression::none;
+
+        if (compress && !item.bytes.empty()) {
+            int size              = 0;
+            unsigned char* packed = CompressData(item.bytes.data(), static_cast<int>(item.bytes.size()), &size);
+
+            // already compressed formats like png or mp3 usually do not shrink any further
+            if (packed != nullptr && static_cast<size_t>(size) < item.bytes.size()) {
+                item.bytes.assign(packed, packed + size);
+                item.entry.compression = Compression::deflate;
+            }
+
+            MemFree(packed);
+        }
+
+        item.entry.size = item.bytes.size();
+        items.push_back(std::move(item));
+    }
+
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.entry.hash < b.entry.hash; });
+
+    auto collision = std::adjacent_find(
+        items.begin(), items.end(), [](const Item& a, const Item& b) { return a.entry.hash == b.entry.hash; });
+    if (collision != items.end()) {
+        return false;
+    }
+
+    u64 offset = sizeof(Header) + items.size() * sizeof(Entry);
+    for (Item& item : items) {
+        offset            = (offset + alignment - 1) / alignment * alignment;
+        item.entry.offset = offset;
+        offset += item.entry.size;
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    Header header{.magic = magic, .version = version, .count = items.size()};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (const Item& item : items) {
+        out.write(reinterpret_cast<const char*>(&item.entry), sizeof(Entry));
+    }
+
+    const char zeros[alignment] = {};
+    for (const Item& item : items) {
+        out.write(zeros, static_cast<std::streamsize>(item.entry.offset - static_cast<u64>(out.tellp())));
+        out.write(reinterpret_cast<const char*>(item.bytes.data()), static_cast<std::streamsize>(item.bytes.size()));
+    }
+
+    return static_cast<bool>(out);
+}
+
+u64 Archive::hash(std::string_view relative) noexcept
+{
+    return StringId::hash(relative);
+}
+
+Archive::~Archive()
+{
+    if (map_ != nullptr) {
+        munmap(const_cast<byte*>(map_), length_);
+    }
+}
+
+bool Archive::read(const string& relative, Blob& blob) const noexcept
+{
+    u64 key = hash(normalize(relative));
+
+    auto entry = std::lower_bound(
+        index_.begin(), index_.end(), key, [](const Entry& item, u64 value) { return item.hash < value; });
+
+    if (entry == index_.end() || entry->hash != key) {
+        return false;
+    }
+
+    std::span<const byte> bytes(map_ + entry->offset, static_cast<size_t>(entry->size));
+
+    if (entry->compression == Compression::none) {
+        blob = Blob(shared_from_this(), bytes);
+        return true;
+    }
+
+    int size                = 0;
+    unsigned char* inflated = DecompressData(bytes.data(), static_cast<int>(bytes.size()), &size);
+
+    if (inflated == nullptr || static_cast<u64>(size) != entry->raw) {
+        MemFree(inflated);
+        return false;
+    }
+
+    blob = Blob(std::vector<byte>(inflated, inflated + size));
+    MemFree(inflated);
+
+    return true;
+}
+
+size_t Archive::size() const noexcept
+{
+    return index_.size();
+}
+
+} // namespace engine
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "defines.hpp"
+
+namespace engine {
+
+class Archive;
+
+/*
+ * Bytes of a file, either a view into a mapped archive, which stays mapped while the blob
+ * is alive, or an owned buffer
+ */
+class Blob {
+public:
+    Blob() = default;
+
+    Blob(sptr<const Archive> archive, std::span<const byte> view) noexcept;
+
+    Blob(std::vector<byte> owned) noexcept;
+
+    Blob(Blob&&) noexcept            = default;
+    Blob& operator=(Blob&&) noexcept = default;
+
+    Blob(const Blob&)            = delete;
+    Blob& operator=(const Blob&) = delete;
+
+    const byte* data() const noexcept;
+
+    size_t size() const noexcept;
+
+    bool empty() const noexcept;
+
+private:
+    sptr<const Archive> archive_;
+    std::vector<byte> owned_;
+    std::span<const byte> view_;
+};
+
+/*
+ * Single read-only file of assets, mapped into memory as a whole. Layout, native endianness:
+ *
+ *   header   magic "YNGP", version, entry count
+ *   index    entries sorted by FNV-1a hash of the relative path
+ *   data     file contents, each aligned to 16 bytes
+ *
+ * Compressed entries are DEFLATE streams and are inflated into an owned buffer on read,
+ * stored ones are served straight from the mapping.
+ */
+class Archive : public std::enable_shared_from_this<Archive> {
+public:
+    static constexpr u32 magic   = 0x50474E59;
+    static constexpr u32 version = 1;
+
+    enum class Compression : u32 {
+        none,
+        deflate,
+    };
+
+    /*
+     * Maps the archive, nullptr when it is missing or malformed
+     */
+    static sptr<Archive> open(const string& path) noexcept;
+
+    /*
+     * Writes files under root into a new archive at path, compressing those that shrink when
+     * compress is set. Fails on unreadable files and on path hash collisions.
+     */
+    static bool write(const string& root, const std::vector<string>& files, const string& path, bool compress) noexcept;
+
+    static u64 hash(std::string_view relative) noexcept;
+
+    Archive(const Archive&)            = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    ~Archive();
+
+    /*
+     * Contents of the file, false when it is not in the archive
+     */
+    bool read(const string& relative, Blob& blob) const noexcept;
+
+    size_t size() const noexcept;
+
+private:
+    struct Header {
+        u32 magic;
+        u32 version;
+        u64 count;
+    };
+
+    struct Entry {
+        u64 hash;
+        u64 offset;
+        u64 size;
+        u64 raw;
+        Compression compression;
+        u32 reserved;
+    };
+
+    Archive() = default;
+
+    rptr<const byte> map_{nullptr};
+    size_t length_{0};
+    std::span<const Entry> index_;
+};
+
+} // namespace engine
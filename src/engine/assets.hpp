@@ -0,0 +1,295 @@
+#pragma once
+
+#include <deque>
+#include <limits>
+#include <vector>
+
+#include "defines.hpp"
+#include "flatmap.hpp"
+#include "loader.hpp"
+
+namespace engine {
+
+/*
+ * Asset handle: slot index plus generation of the slot, generation is bumped every time
+ * the asset is unloaded, so stale handles never alias assets loaded into the slot later
+ */
+struct AssetId {
+    u32 index{0};
+    u32 generation{0};
+
+    bool operator==(const AssetId&) const = default;
+};
+
+/*
+ * Slots of a resource holder. Assets are looked up by alias or by handle and counted in use
+ * while handles acquired for them are not released. Resident bytes are kept under a budget
+ * by evicting assets nobody uses, least recently used first; evicted slots keep their name,
+ * so the holder can bring them back on demand. Slots never move, references stay valid
+ * until the asset is unloaded.
+ *
+ * Unused resident slots are linked into a list in the order they were last touched or released,
+ * so eviction takes them from the front instead of searching all slots.
+ */
+template <typename Alias, typename Asset>
+class AssetTable {
+public:
+    static constexpr AssetId invalid{.index = std::numeric_limits<u32>::max(), .generation = 0};
+    static constexpr u32 none = std::numeric_limits<u32>::max();
+
+    struct Slot {
+        Alias alias{};
+        string name;
+        Asset asset{};
+        size_t bytes{0};
+        u64 used{0};
+        u32 index{0};
+        u32 generation{0};
+        u32 refs{0};
+        // bumped whenever the holder swaps in a reloaded asset
+        u32 revision{0};
+        u32 prev{none};
+        u32 next{none};
+        bool live{false};
+        bool resident{false};
+        bool listed{false};
+        LoadHandle handle;
+    };
+
+    /*
+     * Slot of the alias, a new empty one when there is none
+     */
+    Slot& insert(const Alias& alias, const string& name) noexcept
+    {
+        if (rptr<Slot> slot = find(alias)) {
+            return *slot;
+        }
+
+        u32 index = 0;
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        }
+        else {
+            index = static_cast<u32>(slots_.size());
+            slots_.emplace_back();
+        }
+
+        Slot& slot = slots_[index];
+        slot.alias = alias;
+        slot.name  = name;
+        slot.used  = ++clock_;
+        slot.index = index;
+        slot.live  = true;
+        aliases_.insert(alias, index);
+
+        return slot;
+    }
+
+    rptr<Slot> find(const Alias& alias) noexcept
+    {
+        rptr<u32> index = aliases_.find(alias);
+        return index ? &slots_[*index] : nullptr;
+    }
+
+    /*
+     * Slot of a live handle, nullptr for stale ones
+     */
+    rptr<Slot> find(AssetId id) noexcept
+    {
+        if (id.index >= slots_.size() || !slots_[id.index].live || slots_[id.index].generation != id.generation) {
+            return nullptr;
+        }
+
+        return &slots_[id.index];
+    }
+
+    AssetId id(const Slot& slot) const noexcept
+    {
+        return AssetId{.index = slot.index, .generation = slot.generation};
+    }
+
+    void touch(Slot& slot) noexcept
+    {
+        slot.used = ++clock_;
+        relink(slot);
+    }
+
+    /*
+     * Counts a handle to the asset, which keeps it from being evicted
+     */
+    void acquire(Slot& slot) noexcept
+    {
+        ++slot.refs;
+        relink(slot);
+    }
+
+    /*
+     * Returns true when the last handle went away and the asset can be evicted
+     */
+    bool release(Slot& slot) noexcept
+    {
+        if (slot.refs == 0) {
+            return false;
+        }
+
+        --slot.refs;
+        relink(slot);
+
+        return slot.refs == 0;
+    }
+
+    /*
+     * Marks the asset as loaded and counts its bytes against the budget
+     */
+    void resident(Slot& slot, size_t bytes) noexcept
+    {
+        if (slot.resident) {
+            memory_ -= slot.bytes;
+        }
+
+        slot.bytes    = bytes;
+        slot.resident = true;
+        memory_ += bytes;
+        touch(slot);
+    }
+
+    /*
+     * Frees the slot, the asset has to be released by the holder before
+     */
+    void erase(Slot& slot) noexcept
+    {
+        if (slot.resident) {
+            memory_ -= slot.bytes;
+        }
+
+        unlink(slot);
+        aliases_.erase(slot.alias);
+        free_.push_back(slot.index);
+
+        u32 index      = slot.index;
+        u32 generation = slot.generation + 1;
+
+        slot            = Slot{};
+        slot.index      = index;
+        slot.generation = generation;
+    }
+
+    /*
+     * Calls unload(slot) for unused resident assets, least recently used first, until the
+     * resident bytes fit the budget. The asset touched last is kept, it is the one being handed out.
+     */
+    template <typename Unload>
+    void evict(Unload&& unload) noexcept
+    {
+        // whatever is not listed is in use
+        u32 index = head_;
+
+        while (memory_ > budget_ && index != none) {
+            Slot& slot = slots_[index];
+            index      = slot.next;
+
+            if (slot.used == clock_) {
+                continue;
+            }
+
+            unload(slot);
+            unlink(slot);
+
+            memory_ -= slot.bytes;
+            slot.resident = false;
+            slot.bytes    = 0;
+            slot.asset    = Asset{};
+        }
+    }
+
+    template <typename Body>
+    void each(Body&& body) noexcept
+    {
+        aliases_.each([this, &body](const Alias&, u32 index) { body(slots_[index]); });
+    }
+
+    template <typename Body>
+    void each(Body&& body) const noexcept
+    {
+        aliases_.each([this, &body](const Alias&, u32 index) { body(slots_[index]); });
+    }
+
+    void budget(size_t bytes) noexcept
+    {
+        budget_ = bytes;
+    }
+
+    size_t memory() const noexcept
+    {
+        return memory_;
+    }
+
+    size_t size() const noexcept
+    {
+        return aliases_.size();
+    }
+
+private:
+    /*
+     * Moves the slot to the back of the list when it can be evicted, takes it out otherwise.
+     * Zero byte assets are never listed, evicting them would not free anything.
+     */
+    void relink(Slot& slot) noexcept
+    {
+        unlink(slot);
+
+        if (!slot.resident || slot.refs > 0 || slot.bytes == 0) {
+            return;
+        }
+
+        slot.prev   = tail_;
+        slot.next   = none;
+        slot.listed = true;
+
+        if (tail_ != none) {
+            slots_[tail_].next = slot.index;
+        }
+        else {
+            head_ = slot.index;
+        }
+
+        tail_ = slot.index;
+    }
+
+    void unlink(Slot& slot) noexcept
+    {
+        if (!slot.listed) {
+            return;
+        }
+
+        if (slot.prev != none) {
+            slots_[slot.prev].next = slot.next;
+        }
+        else {
+            head_ = slot.next;
+        }
+
+        if (slot.next != none) {
+            slots_[slot.next].prev = slot.prev;
+        }
+        else {
+            tail_ = slot.prev;
+        }
+
+        slot.prev   = none;
+        slot.next   = none;
+        slot.listed = false;
+    }
+
+    std::deque<Slot> slots_;
+    FlatMap<Alias, u32> aliases_;
+    std::vector<u32> free_;
+    u32 head_{none};
+    u32 tail_{none};
+    u64 clock_{0};
+    size_t memory_{0};
+    size_t budget_{std::numeric_limits<size_t>::max()};
+};
+
+} // namespace engine
@@ -0,0 +1,167 @@
+#include "atlas.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace engine {
+
+RectPacker::RectPacker(i32 width, i32 height) noexcept
+    : width_(width)
+    , height_(height)
+    , skyline_{Segment{.x = 0, .y = 0, .width = width}}
+{
+}
+
+bool RectPacker::pack(i32 w, i32 h, i32& x, i32& y) noexcept
+{
+    size_t best     = skyline_.size();
+    i32 best_top    = std::numeric_limits<i32>::max();
+    i32 best_width  = std::numeric_limits<i32>::max();
+    i32 best_bottom = 0;
+
+    for (size_t i = 0; i < skyline_.size(); ++i) {
+        i32 bottom = 0;
+        if (!fits(i, w, h, bottom)) {
+            continue;
+        }
+
+        // lowest top first, narrower segments on ties leave wider ones for wider rectangles
+        if (bottom + h < best_top || (bottom + h == best_top && skyline_[i].width < best_width)) {
+            best        = i;
+            best_top    = bottom + h;
+            best_width  = skyline_[i].width;
+            best_bottom = bottom;
+        }
+    }
+
+    if (best == skyline_.size()) {
+        return false;
+    }
+
+    x = skyline_[best].x;
+    y = best_bottom;
+
+    skyline_.insert(skyline_.begin() + best, Segment{.x = x, .y = y + h, .width = w});
+
+    // cut segments now covered by the new one
+    for (size_t i = best + 1; i < skyline_.size();) {
+        Segment& segment = skyline_[i];
+        i32 covered      = x + w - segment.x;
+
+        if (covered <= 0) {
+            break;
+        }
+
+        if (covered < segment.width) {
+            segment.x += covered;
+            segment.width -= covered;
+            break;
+        }
+
+        skyline_.erase(skyline_.begin() + i);
+    }
+
+    for (size_t i = 0; i + 1 < skyline_.size();) {
+        if (skyline_[i].y == skyline_[i + 1].y) {
+            skyline_[i].width += skyline_[i + 1].width;
+            skyline_.erase(skyline_.begin() + i + 1);
+        }
+        else {
+            ++i;
+        }
+    }
+
+    return true;
+}
+
+bool RectPacker::fits(size_t index, i32 w, i32 h, i32& y) const noexcept
+{
+    if (skyline_[index].x + w > width_) {
+        return false;
+    }
+
+    i32 left = w;
+    y        = 0;
+
+    for (size_t i = index; left > 0 && i < skyline_.size(); ++i) {
+        y = std::max(y, skyline_[i].y);
+        if (y + h > height_) {
+            return false;
+        }
+        left -= skyline_[i].width;
+    }
+
+    return left <= 0;
+}
+
+Atlas::Atlas(i32 side) noexcept
+    : side_(side)
+{
+}
+
+Atlas::~Atlas()
+{
+    for (Page& page : pages_) {
+        UnloadTexture(page.texture);
+    }
+
+    for (Texture2D& texture : large_) {
+        UnloadTexture(texture);
+    }
+}
+
+Region Atlas::add(Image image) noexcept
+{
+    if (image.data == nullptr) {
+        return Region{};
+    }
+
+    // the gutter keeps neighbours from bleeding into filtered samples
+    i32 w = image.width + padding;
+    i32 h = image.height + padding;
+
+    if (w > side_ || h > side_) {
+        Texture2D texture = LoadTextureFromImage(image);
+        large_.push_back(texture);
+
+        return Region{.texture = texture, .rect = Rectangle{0.0f, 0.0f, f32(image.width), f32(image.height)}};
+    }
+
+    i32 x = 0;
+    i32 y = 0;
+
+    auto page = std::find_if(pages_.begin(), pages_.end(), [&](Page& candidate) {
+        return candidate.packer.pack(w, h, x, y);
+    });
+
+    if (page == pages_.end()) {
+        Image blank = GenImageColor(side_, side_, Color{0, 0, 0, 0});
+        pages_.push_back(Page{.texture = LoadTextureFromImage(blank), .packer = RectPacker(side_, side_)});
+        UnloadImage(blank);
+
+        page = pages_.end() - 1;
+        page->packer.pack(w, h, x, y);
+    }
+
+    Rectangle rect{f32(x), f32(y), f32(image.width), f32(image.height)};
+
+    // pages are RGBA8, so the pixels have to match before the upload
+    if (image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {
+        Image copy = ImageCopy(image);
+        ImageFormat(&copy, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        UpdateTextureRec(page->texture, rect, copy.data);
+        UnloadImage(copy);
+    }
+    else {
+        UpdateTextureRec(page->texture, rect, image.data);
+    }
+
+    return Region{.texture = page->texture, .rect = rect};
+}
+
+size_t Atlas::textures() const noexcept
+{
+    return pages_.size() + large_.size();
+}
+
+} // namespace engine
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+
+#include "defines.hpp"
+
+namespace engine {
+
+/*
+ * Part of a texture, either a whole texture or a packed image on an atlas page
+ */
+struct Region {
+    Texture2D texture{};
+    Rectangle rect{};
+};
+
+/*
+ * Skyline bottom-left rectangle packer. Keeps the top edge of the packed area as a list of
+ * segments and places every rectangle where its top ends up lowest.
+ */
+class RectPacker {
+public:
+    RectPacker(i32 width, i32 height) noexcept;
+
+    /*
+     * Reserves a w by h rectangle, returns false when it does not fit
+     */
+    bool pack(i32 w, i32 h, i32& x, i32& y) noexcept;
+
+private:
+    struct Segment {
+        i32 x;
+        i32 y;
+        i32 width;
+    };
+
+    bool fits(size_t index, i32 w, i32 h, i32& y) const noexcept;
+
+    i32 width_{0};
+    i32 height_{0};
+    std::vector<Segment> skyline_;
+};
+
+/*
+ * Square texture pages that images are packed into as they are added. Every image is copied
+ * into its page right away, so regions stay valid while more images are added.
+ * Images larger than a page get a texture of their own.
+ */
+class Atlas {
+public:
+    static constexpr i32 padding = 1;
+
+    Atlas(i32 side) noexcept;
+
+    Atlas(const Atlas&)            = delete;
+    Atlas& operator=(const Atlas&) = delete;
+
+    ~Atlas();
+
+    /*
+     * Uploads the image into a page, the image stays owned by the caller
+     */
+    Region add(Image image) noexcept;
+
+    /*
+     * Pages and standalone textures of large images
+     */
+    size_t textures() const noexcept;
+
+private:
+    struct Page {
+        Texture2D texture;
+        RectPacker packer;
+    };
+
+    i32 side_{0};
+    std::vector<Page> pages_;
+    std::vector<Texture2D> large_;
+};
+
+} // namespace engine
@@ -1,9 +1,88 @@
 #include "core.hpp"
 
+#include <chrono>
+#include <cmath>
+
 #include "raylib.h"
 
+#include "mixer.hpp"
+#include "profiling.hpp"
+
 namespace engine {
 
+uptr<Platform> Platform::instance_ = nullptr;
+
+rptr<Platform> Platform::get()
+{
+    if (!instance_) {
+        instance_ = std::make_unique<Platform>();
+    }
+
+    return instance_.get();
+}
+
+void Platform::headless(f32 step) noexcept
+{
+    headless_ = true;
+    step_     = step;
+}
+
+bool Platform::headless() const noexcept
+{
+    return headless_;
+}
+
+void Platform::tick(f32 step) noexcept
+{
+    tick_ = step;
+}
+
+void Platform::alpha(f32 alpha) noexcept
+{
+    alpha_ = alpha;
+}
+
+f32 Platform::frame_time() const noexcept
+{
+    if (tick_ > 0.0f) {
+        return tick_;
+    }
+
+    return headless_ ? step_ : GetFrameTime();
+}
+
+f32 Platform::alpha() const noexcept
+{
+    return alpha_;
+}
+
+i32 Platform::fps() const noexcept
+{
+    return headless_ ? static_cast<i32>(1.0f / step_) : GetFPS();
+}
+
+bool Platform::key_pressed(i32 key) const noexcept
+{
+    return headless_ ? false : IsKeyPressed(key);
+}
+
+vec2 Platform::mouse() const noexcept
+{
+    if (headless_) {
+        return vec2();
+    }
+
+    Vector2 pos = GetMousePosition();
+    return vec2(pos.x, pos.y);
+}
+
+void Platform::hide_cursor() const noexcept
+{
+    if (!headless_) {
+        HideCursor();
+    }
+}
+
 Game::Game(i32 width, i32 height, cstr title) noexcept
     : width_(width)
     , height_(height)
@@ -21,6 +100,10 @@ Game::Game(cstr title) noexcept
 
 void Game::setup() noexcept
 {
+    if (Platform::get()->headless()) {
+        return;
+    }
+
     InitWindow(width_, height_, title_);
     if (fullscreen_) {
         ToggleFullscreen();
@@ -30,10 +113,17 @@ void Game::setup() noexcept
     SetTargetFPS(120);
     SetExitKey(0);
     InitAudioDevice();
+    Mixer::get()->open();
 }
 
+void Game::step() noexcept {}
+
 bool Game::running() noexcept
 {
+    if (Platform::get()->headless()) {
+        return !exit_;
+    }
+
     return !WindowShouldClose() && !exit_;
 }
 
@@ -55,13 +145,20 @@ i32 Game::height() const noexcept
 
 void Game::shutdown() noexcept
 {
+    if (Platform::get()->headless()) {
+        return;
+    }
+
+    Mixer::get()->close();
     CloseAudioDevice();
     CloseWindow();
 }
 
 
-Runner::Runner(uptr<IGame> game) noexcept
+Runner::Runner(uptr<IGame> game, f32 rate, u32 max_steps) noexcept
     : game_(std::move(game))
+    , rate_(rate)
+    , max_steps_(max_steps)
 {
 }
 
@@ -69,11 +166,90 @@ void Runner::run() noexcept
 {
     game_->setup();
 
+    if (rate_ <= 0.0f) {
+        while (game_->running()) {
+            PROFILE_FRAME();
+            game_->step();
+            game_->update();
+        }
+
+        game_->shutdown();
+        return;
+    }
+
+    f64 tick = 1.0 / rate_;
+
+    f64 accumulator = 0.0;
+    auto last       = std::chrono::steady_clock::now();
+
     while (game_->running()) {
+        PROFILE_FRAME();
+
+        auto now = std::chrono::steady_clock::now();
+        accumulator += std::chrono::duration<f64>(now - last).count();
+        last = now;
+
+        // only steps see the tick as frame time, update() gets the real frame time
+        Platform::get()->tick(static_cast<f32>(tick));
+
+        u32 steps = 0;
+        for (; accumulator >= tick && steps < max_steps_; ++steps) {
+            game_->step();
+            accumulator -= tick;
+        }
+
+        Platform::get()->tick(0.0f);
+
+        // spiral of death: steps that did not fit are dropped instead of piling up
+        if (accumulator >= tick) {
+            accumulator = std::fmod(accumulator, tick);
+        }
+
+        Platform::get()->alpha(static_cast<f32>(accumulator / tick));
+        game_->update();
+    }
+
+    game_->shutdown();
+}
+
+HeadlessRunner::HeadlessRunner(uptr<IGame> game, size_t frames, f32 step) noexcept
+    : game_(std::move(game))
+    , frames_(frames)
+    , step_(step)
+{
+}
+
+void HeadlessRunner::run() noexcept
+{
+    Platform::get()->headless(step_);
+
+    game_->setup();
+
+    auto begin = std::chrono::steady_clock::now();
+
+    size_t frame = 0;
+    for (; frame < frames_ && game_->running(); ++frame) {
+        PROFILE_FRAME();
+        game_->step();
         game_->update();
     }
 
+    std::chrono::duration<f64> diff = std::chrono::steady_clock::now() - begin;
+
+    frames_  = frame;
+    elapsed_ = diff.count();
+
     game_->shutdown();
 }
 
+size_t HeadlessRunner::frames() const noexcept
+{
+    return frames_;
+}
+
+f64 HeadlessRunner::elapsed() const noexcept
+{
+    return elapsed_;
+}
+
 } // namespace engine
@@ -3,9 +3,59 @@
 #include "defines.hpp"
 
 namespace engine {
+/*
+ * Time and input as seen by the game. Headless mode has no window or audio device,
+ * reports no input and advances time by a fixed step, so runs are reproducible.
+ * While a fixed step runs, frame_time() is the tick; afterwards alpha() tells render code
+ * how far the frame is between the last two ticks.
+ */
+class Platform {
+public:
+    void headless(f32 step) noexcept;
+
+    bool headless() const noexcept;
+
+    void tick(f32 step) noexcept;
+
+    void alpha(f32 alpha) noexcept;
+
+    /*
+     * Seconds one step() advances the simulation by inside fixed steps, the frame time otherwise
+     */
+    f32 frame_time() const noexcept;
+
+    /*
+     * Fraction of a tick the frame is past the last step, 1 without a fixed tick
+     */
+    f32 alpha() const noexcept;
+
+    i32 fps() const noexcept;
+
+    bool key_pressed(i32 key) const noexcept;
+
+    vec2 mouse() const noexcept;
+
+    void hide_cursor() const noexcept;
+
+    static rptr<Platform> get();
+
+    static uptr<Platform> instance_;
+
+private:
+    bool headless_{false};
+    f32 step_{0.0f};
+    f32 tick_{0.0f};
+    f32 alpha_{1.0f};
+};
+
+/*
+ * step() advances the simulation by one tick, update() runs once per rendered frame after
+ * the steps of the frame
+ */
 class IGame {
 public:
     virtual void setup() noexcept    = 0;
+    virtual void step() noexcept     = 0;
     virtual void update() noexcept   = 0;
     virtual void shutdown() noexcept = 0;
     virtual bool running() noexcept  = 0;
@@ -20,6 +70,8 @@ public:
 
     void setup() noexcept override;
 
+    void step() noexcept override;
+
     bool running() noexcept override;
 
     void shutdown() noexcept override;
@@ -45,13 +97,44 @@ public:
     virtual ~IRunner() = default;
 };
 
+/*
+ * Without a rate steps once per frame with the frame time. With a rate the simulation runs
+ * at rate steps per second whatever the frame rate is: time is accumulated and every frame
+ * runs as many steps as fit, at most max_steps. Time past that is dropped, so a machine that
+ * cannot keep up slows the game down instead of falling further behind every frame.
+ */
 class Runner : public IRunner {
 public:
-    Runner(uptr<IGame> game) noexcept;
+    Runner(uptr<IGame> game, f32 rate = 0.0f, u32 max_steps = 8) noexcept;
 
     void run() noexcept override;
 
 private:
     uptr<IGame> game_;
+    f32 rate_{0.0f};
+    u32 max_steps_{8};
+};
+
+/*
+ * Runs the game for a fixed number of frames of step seconds each, without a window
+ */
+class HeadlessRunner : public IRunner {
+public:
+    HeadlessRunner(uptr<IGame> game, size_t frames, f32 step) noexcept;
+
+    void run() noexcept override;
+
+    size_t frames() const noexcept;
+
+    /*
+     * Wall time of the update loop in seconds, setup and shutdown excluded
+     */
+    f64 elapsed() const noexcept;
+
+private:
+    uptr<IGame> game_;
+    size_t frames_{0};
+    f32 step_{0.0f};
+    f64 elapsed_{0.0};
 };
 } // namespace engine
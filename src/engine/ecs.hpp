@@ -1,13 +1,18 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <bitset>
+#include <functional>
 #include <numeric>
+#include <span>
 #include <tuple>
 #include <type_traits>
 #include <vector>
 
 #include "defines.hpp"
+#include "jobs.hpp"
 
 namespace engine::ecs {
 
@@ -48,6 +53,122 @@ template <typename... Ts>
 constexpr std::array<size_t, Count<Ts...>> Sizes = {sizeof(Ts)...};
 } // namespace utils
 
+/*
+ * Monotonic counter of storage, advanced every time a system starts
+ */
+using Tick = u32;
+
+/*
+ * Query filters, match entities whose component was added or mutably accessed
+ * after the given tick
+ */
+template <typename Component>
+struct Added {
+    Tick since{0};
+};
+
+template <typename Component>
+struct Changed {
+    Tick since{0};
+};
+
+/*
+ * Matches entities where any of the components was added or mutably accessed after the tick,
+ * entities only need some of the components
+ */
+template <typename... Components>
+struct AnyChanged {
+    Tick since{0};
+};
+
+namespace detail {
+struct TickFilter {
+    size_t component{0};
+    bool added{false};
+    Tick since{0};
+    // filters marked any pass together when at least one of them does
+    bool any{false};
+};
+
+constexpr size_t max_filters = 8;
+
+using TickFilters = std::array<TickFilter, max_filters>;
+
+template <typename Filter>
+constexpr size_t filter_size = 1;
+
+template <typename... Components>
+constexpr size_t filter_size<AnyChanged<Components...>> = sizeof...(Components);
+
+/*
+ * Flattens query filters into tick filters, Index maps a component type to its index
+ */
+template <template <typename> typename Index>
+struct FilterBuilder {
+    template <typename Component>
+    void add(Added<Component> filter) noexcept
+    {
+        filters[count++] = TickFilter{.component = Index<Component>::value, .added = true, .since = filter.since};
+    }
+
+    template <typename Component>
+    void add(Changed<Component> filter) noexcept
+    {
+        filters[count++] = TickFilter{.component = Index<Component>::value, .added = false, .since = filter.since};
+    }
+
+    template <typename... Components>
+    void add(AnyChanged<Components...> filter) noexcept
+    {
+        ((filters[count++] = TickFilter{
+              .component = Index<Components>::value,
+              .added     = false,
+              .since     = filter.since,
+              .any       = true}),
+         ...);
+    }
+
+    TickFilters filters{};
+    size_t count{0};
+};
+
+// start tick of the system running on this thread, 0 outside of systems
+inline thread_local Tick system_tick = 0;
+} // namespace detail
+
+/*
+ * Stamps changes made on this thread with the tick the running system started at. Other systems
+ * advance the storage tick meanwhile, a system writing with the latest tick would see its own
+ * changes as newer than its start on the next update.
+ */
+class TickScope {
+public:
+    explicit TickScope(Tick tick) noexcept
+        : previous_(detail::system_tick)
+    {
+        detail::system_tick = tick;
+    }
+
+    TickScope(const TickScope&)            = delete;
+    TickScope& operator=(const TickScope&) = delete;
+
+    ~TickScope()
+    {
+        detail::system_tick = previous_;
+    }
+
+private:
+    Tick previous_{0};
+};
+
+template <typename Entity>
+class EntityStorage;
+
+/*
+ * Components are accessed by type, const qualified types give read-only access
+ * which is not tracked by change detection. Mutable access and adding components
+ * go through the storage, which records them for change detection.
+ */
 template <typename... Components>
 class Entity {
 public:
@@ -66,7 +187,7 @@ public:
     template <typename Component>
     static constexpr size_t index() noexcept
     {
-        return utils::Index<Component, Components...>;
+        return utils::Index<std::remove_const_t<Component>, Components...>;
     }
 
     template <typename Component>
@@ -81,12 +202,60 @@ public:
         return (components_[index<RequaredComponents>()] && ...);
     }
 
-    template <typename Component, typename... Args>
-    Component& add(Args... args) noexcept
+    bool contains(size_t component) const noexcept
     {
-        new (ptr<Component>()) Component(std::forward<Args>(args)...);
-        enable<Component>();
-        return *ptr<Component>();
+        return components_[component];
+    }
+
+    Tick added(size_t component) const noexcept
+    {
+        return added_[component];
+    }
+
+    Tick changed(size_t component) const noexcept
+    {
+        return changed_[component];
+    }
+
+    /*
+     * Records mutable access to a component, const access is not tracked
+     */
+    template <typename Component>
+    void touch(Tick tick) noexcept
+    {
+        if constexpr (!std::is_const_v<Component>) {
+            changed_[index<Component>()] = tick;
+        }
+    }
+
+    template <typename Component>
+    void stamp(Tick tick) noexcept
+    {
+        added_[index<Component>()]   = tick;
+        changed_[index<Component>()] = tick;
+    }
+
+    bool matches(const detail::TickFilters& filters, size_t count) const noexcept
+    {
+        bool any  = false;
+        bool some = false;
+
+        for (size_t f = 0; f < count; ++f) {
+            const detail::TickFilter& filter = filters[f];
+
+            Tick tick = filter.added ? added_[filter.component] : changed_[filter.component];
+            bool ok   = components_[filter.component] && tick > filter.since;
+
+            if (filter.any) {
+                any  = true;
+                some = some || ok;
+            }
+            else if (!ok) {
+                return false;
+            }
+        }
+
+        return !any || some;
     }
 
     template <typename... RequaredComponents>
@@ -106,13 +275,33 @@ public:
         disable<Components...>();
     }
 
+    template <typename Component>
+    const std::remove_const_t<Component>& get() const noexcept
+    {
+        return *ptr<std::remove_const_t<Component>>();
+    }
+
+private:
+    template <typename>
+    friend class EntityStorage;
+
+    template <typename Component, typename... Args>
+    Component& add(Args... args) noexcept
+    {
+        new (ptr<Component>()) Component(std::forward<Args>(args)...);
+        enable<Component>();
+        return *ptr<Component>();
+    }
+
+    /*
+     * Callers record the access with touch() first
+     */
     template <typename Component>
     Component& get() noexcept
     {
         return *ptr<Component>();
     }
 
-private:
     template <typename Component>
     static constexpr size_t offset() noexcept
     {
@@ -125,6 +314,12 @@ private:
         return reinterpret_cast<Component*>(components_storage_.data() + offset<Component>());
     }
 
+    template <typename Component>
+    const Component* ptr() const noexcept
+    {
+        return reinterpret_cast<const Component*>(components_storage_.data() + offset<Component>());
+    }
+
     static constexpr size_t count_ = utils::Count<Components...>;
     static constexpr size_t size_  = utils::Size<Components...>;
     static constexpr auto sizes_   = utils::Sizes<Components...>;
@@ -136,10 +331,123 @@ private:
     using component_storage_t = std::array<byte, J>;
 
     component_index_t<count_> components_{0};
+    std::array<Tick, count_> added_{};
+    std::array<Tick, count_> changed_{};
     component_storage_t<size_> components_storage_;
 };
 
-using EntityId = size_t;
+/*
+ * Entity handle: slot index plus generation of the slot, generation is bumped
+ * every time the slot dies, so stale handles never alias recycled slots
+ */
+struct EntityId {
+    u32 index{0};
+    u32 generation{0};
+
+    bool operator==(const EntityId&) const = default;
+};
+
+/*
+ * Called with the entity when a component leaves it, removed on its own or with the entity
+ */
+using remove_hook_t = std::function<void(EntityId)>;
+
+/*
+ * Amount of component data handed to one worker by parallel queries
+ */
+constexpr size_t parallel_chunk_bytes = 16 * 1024;
+
+/*
+ * Set of entity ids with O(1) insert, erase and lookup, ids are kept densely packed for iteration
+ */
+class SparseSet {
+public:
+    bool contains(EntityId i) const noexcept
+    {
+        return i.index < sparse_.size() && sparse_[i.index] != npos;
+    }
+
+    void insert(EntityId i) noexcept
+    {
+        if (contains(i)) {
+            return;
+        }
+
+        if (i.index >= sparse_.size()) {
+            sparse_.resize(i.index + 1, npos);
+        }
+
+        sparse_[i.index] = dense_.size();
+        dense_.push_back(i);
+    }
+
+    void erase(EntityId i) noexcept
+    {
+        if (!contains(i)) {
+            return;
+        }
+
+        EntityId last            = dense_.back();
+        dense_[sparse_[i.index]] = last;
+        sparse_[last.index]      = sparse_[i.index];
+        sparse_[i.index]         = npos;
+        dense_.pop_back();
+    }
+
+    /*
+     * Erases a batch of ids. Batches that are large next to the set are dropped in a single
+     * compacting pass over the dense array instead of being swapped out one by one.
+     */
+    void erase_many(std::span<const EntityId> ids) noexcept
+    {
+        if (ids.size() * 4 < dense_.size()) {
+            for (EntityId i : ids) {
+                erase(i);
+            }
+            return;
+        }
+
+        for (EntityId i : ids) {
+            if (contains(i)) {
+                sparse_[i.index] = npos;
+            }
+        }
+
+        size_t kept = 0;
+        for (EntityId i : dense_) {
+            if (sparse_[i.index] != npos) {
+                sparse_[i.index] = kept;
+                dense_[kept++]   = i;
+            }
+        }
+
+        dense_.resize(kept);
+    }
+
+    size_t size() const noexcept
+    {
+        return dense_.size();
+    }
+
+    /*
+     * Bytes occupied by the sparse and dense arrays
+     */
+    size_t memory() const noexcept
+    {
+        return sparse_.capacity() * sizeof(size_t) + dense_.capacity() * sizeof(EntityId);
+    }
+
+    const std::vector<EntityId>& ids() const noexcept
+    {
+        return dense_;
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    std::vector<size_t> sparse_;
+    std::vector<EntityId> dense_;
+};
 
 template <typename Entity>
 class EntityStorage {
@@ -150,45 +458,170 @@ public:
     EntityId create() noexcept
     {
         if (dead_.size() > 0) {
-            EntityId result = dead_.back();
+            u32 index = dead_.back();
             dead_.pop_back();
-            return result;
+            return EntityId{.index = index, .generation = generations_[index]};
         }
         else {
-            EntityId result = entities_.size();
+            u32 index = entities_.size();
             entities_.emplace_back();
-            return result;
+            generations_.push_back(0);
+            return EntityId{.index = index, .generation = 0};
         }
     }
 
-    EntityId size() const noexcept
+    size_t size() const noexcept
     {
         return entities_.size();
     }
 
-    EntityId active() const noexcept
+    size_t active() const noexcept
     {
         return entities_.size() - dead_.size();
     }
 
+    bool alive(EntityId i) const noexcept
+    {
+        return i.index < generations_.size() && generations_[i.index] == i.generation;
+    }
+
+    /*
+     * Bytes occupied by entities, their generations and free slots, and component pools
+     */
+    size_t memory() const noexcept
+    {
+        size_t result = entities_.capacity() * sizeof(Entity) + generations_.capacity() * sizeof(u32) +
+                        dead_.capacity() * sizeof(u32);
+
+        for (const SparseSet& pool : pools_) {
+            result += pool.memory();
+        }
+
+        return result;
+    }
+
+    /*
+     * Access to entity data, adding and removing components has to go through the storage
+     * to keep component pools in sync
+     */
     Entity& get(EntityId i) noexcept
     {
-        return entities_[i];
+        assert(alive(i));
+        return entities_[i.index];
+    }
+
+    Tick tick() const noexcept
+    {
+        return tick_.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * Tick changes are stamped with: the one of the running system, the current one outside of systems
+     */
+    Tick write_tick() const noexcept
+    {
+        return detail::system_tick != 0 ? detail::system_tick : tick();
+    }
+
+    /*
+     * Starts a new tick, changes made from now on are newer than everything before
+     */
+    Tick advance() noexcept
+    {
+        return tick_.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    template <typename Component, typename... Args>
+    Component& add(EntityId i, Args... args) noexcept
+    {
+        pools_[Entity::template index<Component>()].insert(i);
+        get(i).template stamp<Component>(write_tick());
+        return get(i).template add<Component>(std::forward<Args>(args)...);
+    }
+
+    /*
+     * Removing a dead or stale handle is a no-op
+     */
+    void remove(EntityId i) noexcept
+    {
+        if (!alive(i)) {
+            return;
+        }
+
+        removing(i);
+
+        for (SparseSet& pool : pools_) {
+            pool.erase(i);
+        }
+
+        entities_[i.index].destroy();
+        ++generations_[i.index];
+        dead_.push_back(i.index);
     }
 
+    /*
+     * Removes a batch pool by pool, each pool is walked once for the whole batch
+     */
+    void remove_many(std::span<const EntityId> ids) noexcept
+    {
+        batch_.clear();
+
+        // bumping the generation right away drops handles listed twice
+        for (EntityId i : ids) {
+            if (alive(i)) {
+                removing(i);
+                ++generations_[i.index];
+                batch_.push_back(i);
+            }
+        }
+
+        for (SparseSet& pool : pools_) {
+            pool.erase_many(batch_);
+        }
+
+        dead_.reserve(dead_.size() + batch_.size());
+        for (EntityId i : batch_) {
+            entities_[i.index].destroy();
+            dead_.push_back(i.index);
+        }
+    }
+
+    template <typename Component>
     void remove(EntityId i) noexcept
     {
-        if (std::find(dead_.begin(), dead_.end(), i) == dead_.end()) {
-            entities_[i].destroy();
-            dead_.push_back(i);
+        if (!alive(i) || !entities_[i.index].template contains<Component>()) {
+            return;
+        }
+
+        removing(i, Entity::template index<Component>());
+
+        pools_[Entity::template index<Component>()].erase(i);
+        entities_[i.index].template disable<Component>();
+    }
+
+    /*
+     * Makes room for count more entities
+     */
+    void reserve(size_t count) noexcept
+    {
+        if (count > dead_.size()) {
+            entities_.reserve(entities_.size() + count - dead_.size());
+            generations_.reserve(generations_.size() + count - dead_.size());
         }
     }
 
+    /*
+     * Walks the smallest pool among required components, so cost is bound by the rarest component
+     */
     template <typename... RequaredComponents>
     class Iterator {
     public:
-        Iterator(EntityStorage& storage) noexcept
+        Iterator(EntityStorage& storage, const detail::TickFilters& filters = {}, size_t filters_count = 0) noexcept
             : storage_(storage)
+            , ids_(storage.smallest<RequaredComponents...>().ids())
+            , filters_(filters)
+            , filters_count_(filters_count)
+            , tick_(storage.write_tick())
         {
             while (!end() && !good()) {
                 ++curr_;
@@ -197,7 +630,9 @@ public:
 
         ComponentsRefs<RequaredComponents...> operator*() const noexcept
         {
-            return ComponentsRefs<RequaredComponents...>(storage_.get(curr_).template get<RequaredComponents>()...);
+            Entity& e = storage_.get(id());
+            (e.template touch<RequaredComponents>(tick_), ...);
+            return ComponentsRefs<RequaredComponents...>(e.template get<RequaredComponents>()...);
         }
 
         Iterator& operator++() noexcept
@@ -216,35 +651,74 @@ public:
 
         EntityId id() const noexcept
         {
-            return curr_;
+            return ids_[curr_];
         }
 
     private:
         bool good() noexcept
         {
-            return storage_.get(curr_).template contains<RequaredComponents...>();
+            const Entity& e = storage_.get(id());
+            return e.template contains<RequaredComponents...>() && e.matches(filters_, filters_count_);
         }
 
         bool end() const noexcept
         {
-            return curr_ >= storage_.size();
+            return curr_ >= ids_.size();
         }
 
-        EntityId curr_{0};
+        size_t curr_{0};
         EntityStorage& storage_;
+        const std::vector<EntityId>& ids_;
+        detail::TickFilters filters_;
+        size_t filters_count_{0};
+        Tick tick_{0};
     };
 
+    /*
+     * Optional Added<Component>, Changed<Component> and AnyChanged<Components...> filters narrow the query down
+     */
+    template <typename... RequaredComponents, typename... Filters>
+    Iterator<RequaredComponents...> iterator(Filters... filters) noexcept
+    {
+        static_assert((detail::filter_size<Filters> + ... + 0) <= detail::max_filters);
+
+        detail::FilterBuilder<ComponentIndex> builder;
+        (builder.add(filters), ...);
+
+        return Iterator<RequaredComponents...>(*this, builder.filters, builder.count);
+    }
+
+    /*
+     * Calls hook right before Component leaves an entity, removed on its own or with the entity.
+     * The component can still be read from the hook.
+     */
+    template <typename Component>
+    void on_remove(remove_hook_t hook) noexcept
+    {
+        hooks_[Entity::template index<Component>()].push_back(std::move(hook));
+    }
+
+    /*
+     * Components of one entity, mutable access is recorded for change detection
+     */
     template <typename... RequaredComponents>
-    Iterator<RequaredComponents...> iterator() noexcept
+    ComponentsRefs<RequaredComponents...> get(EntityId i) noexcept
     {
-        return Iterator<RequaredComponents...>(*this);
+        Entity& e = get(i);
+        assert(e.template contains<RequaredComponents...>());
+
+        (e.template touch<RequaredComponents>(write_tick()), ...);
+        return ComponentsRefs<RequaredComponents...>(e.template get<RequaredComponents>()...);
     }
 
     template <typename... RequaredComponents>
     std::tuple<RequaredComponents&...> get() noexcept
     {
-        for (Entity& e : entities_) {
+        for (EntityId i : smallest<RequaredComponents...>().ids()) {
+            Entity& e = entities_[i.index];
+
             if (e.template contains<RequaredComponents...>()) {
+                (e.template touch<RequaredComponents>(write_tick()), ...);
                 return ComponentsRefs<RequaredComponents...>(e.template get<RequaredComponents>()...);
             }
         }
@@ -253,15 +727,77 @@ public:
         __builtin_unreachable();
     }
 
+    /*
+     * Calls body(components...) for every matching entity, matches are split into chunks
+     * of roughly parallel_chunk_bytes and each entity is visited by exactly one worker.
+     * Structural changes are not allowed until it returns.
+     */
+    template <typename... RequaredComponents, typename Body>
+    void parallel_for_each(Body&& body) noexcept
+    {
+        const std::vector<EntityId>& ids = smallest<RequaredComponents...>().ids();
+        const Tick now                   = write_tick();
+
+        jobs::Pool::get()->parallel_for(
+            0,
+            ids.size(),
+            std::max<size_t>(1, parallel_chunk_bytes / sizeof(Entity)),
+            [this, &ids, &body, now](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; ++k) {
+                    Entity& e = entities_[ids[k].index];
+
+                    if (e.template contains<RequaredComponents...>()) {
+                        (e.template touch<RequaredComponents>(now), ...);
+                        body(e.template get<RequaredComponents>()...);
+                    }
+                }
+            });
+    }
+
 private:
+    template <typename Component>
+    struct ComponentIndex : std::integral_constant<size_t, Entity::template index<Component>()> {};
+
+    /*
+     * Runs remove hooks of every component the entity has
+     */
+    void removing(EntityId i) noexcept
+    {
+        for (size_t c = 0; c < Entity::count(); ++c) {
+            if (entities_[i.index].contains(c)) {
+                removing(i, c);
+            }
+        }
+    }
+
+    void removing(EntityId i, size_t component) noexcept
+    {
+        for (const remove_hook_t& hook : hooks_[component]) {
+            hook(i);
+        }
+    }
+
+    template <typename... RequaredComponents>
+    const SparseSet& smallest() const noexcept
+    {
+        return *std::min(
+            {&pools_[Entity::template index<RequaredComponents>()]...},
+            [](const SparseSet* a, const SparseSet* b) { return a->size() < b->size(); });
+    }
+
     std::vector<Entity> entities_;
-    std::vector<EntityId> dead_;
+    std::vector<u32> generations_;
+    std::vector<u32> dead_;
+    std::vector<EntityId> batch_;
+    std::array<SparseSet, Entity::count()> pools_;
+    std::array<std::vector<remove_hook_t>, Entity::count()> hooks_;
+    std::atomic<Tick> tick_{1};
 };
 
-template <typename Entity>
+template <typename Entity, typename Storage = EntityStorage<Entity>>
 class EntityBuilder {
 public:
-    EntityBuilder(EntityStorage<Entity>& storage)
+    EntityBuilder(Storage& storage)
         : storage_(storage)
     {
     }
@@ -275,47 +811,349 @@ public:
     template <typename Component, typename... Args>
     EntityBuilder& with(Args... args) noexcept
     {
-        storage_.get(current_).template add<Component>(std::forward<Args>(args)...);
+        storage_.template add<Component>(current_, std::forward<Args>(args)...);
         return *this;
     }
 
     void build() noexcept {}
 
 private:
-    size_t current_{0};
-    EntityStorage<Entity>& storage_;
+    EntityId current_{};
+    Storage& storage_;
 };
 
+/*
+ * Structural changes recorded during system updates and applied later in one pass.
+ * Entities created by the buffer can only be referenced through the returned Spawn.
+ */
+template <typename Storage>
+class CommandBuffer {
+public:
+    class Spawn {
+    public:
+        Spawn(CommandBuffer& buffer, size_t index) noexcept
+            : buffer_(buffer)
+            , index_(index)
+        {
+        }
+
+        template <typename Component, typename... Args>
+        Spawn& with(Args... args) noexcept
+        {
+            buffer_.commands_.push_back(
+                [index = index_, ... args = std::move(args)](Storage& storage, std::vector<EntityId>& created) {
+                    storage.template add<Component>(created[index], args...);
+                });
+            return *this;
+        }
+
+        void build() noexcept {}
+
+    private:
+        CommandBuffer& buffer_;
+        size_t index_;
+    };
+
+    Spawn create() noexcept
+    {
+        commands_.push_back(
+            [](Storage& storage, std::vector<EntityId>& created) { created.push_back(storage.create()); });
+        return Spawn(*this, creates_++);
+    }
+
+    template <typename Component, typename... Args>
+    void add(EntityId i, Args... args) noexcept
+    {
+        commands_.push_back([i, ... args = std::move(args)](Storage& storage, std::vector<EntityId>&) {
+            if (storage.alive(i)) {
+                storage.template add<Component>(i, args...);
+            }
+        });
+    }
+
+    template <typename Component>
+    void remove(EntityId i) noexcept
+    {
+        commands_.push_back([i](Storage& storage, std::vector<EntityId>&) { storage.template remove<Component>(i); });
+    }
+
+    void destroy(EntityId i) noexcept
+    {
+        destroyed_.push_back(i);
+    }
+
+    size_t creates() const noexcept
+    {
+        return creates_;
+    }
+
+    /*
+     * Replays creates and component changes in recording order, destroyed entities are
+     * handed to the caller to be removed in bulk
+     */
+    void apply(Storage& storage, std::vector<EntityId>& destroyed) noexcept
+    {
+        created_.clear();
+
+        for (auto& command : commands_) {
+            command(storage, created_);
+        }
+
+        destroyed.insert(destroyed.end(), destroyed_.begin(), destroyed_.end());
+
+        commands_.clear();
+        destroyed_.clear();
+        creates_ = 0;
+    }
+
+private:
+    using command_t = std::function<void(Storage&, std::vector<EntityId>&)>;
+
+    std::vector<command_t> commands_;
+    std::vector<EntityId> created_;
+    std::vector<EntityId> destroyed_;
+    size_t creates_{0};
+};
+
+/*
+ * One command buffer per pool thread, so systems running on workers record without locking
+ */
+template <typename Storage>
+class Commands {
+public:
+    Commands() noexcept
+        : buffers_(jobs::Pool::get()->workers() + 1)
+    {
+    }
+
+    /*
+     * Buffer of the calling thread, has to be called from the main thread or a pool worker
+     */
+    CommandBuffer<Storage>& local() noexcept
+    {
+        return buffers_[jobs::Pool::thread_index()];
+    }
+
+    void apply(Storage& storage) noexcept
+    {
+        size_t creates = 0;
+        for (auto& buffer : buffers_) {
+            creates += buffer.creates();
+        }
+        storage.reserve(creates);
+
+        for (auto& buffer : buffers_) {
+            buffer.apply(storage, destroyed_);
+        }
+
+        storage.remove_many(destroyed_);
+        destroyed_.clear();
+    }
+
+private:
+    std::vector<CommandBuffer<Storage>> buffers_;
+    std::vector<EntityId> destroyed_;
+};
+
+/*
+ * Components a system touches during update, used by SystemManager to run
+ * non-conflicting systems side by side. Exclusive systems conflict with everything,
+ * main thread systems (anything calling raylib) are never moved to workers.
+ */
 template <typename Entity>
+struct Access {
+    using components_t = std::bitset<Entity::count()>;
+
+    components_t reads{0};
+    components_t writes{0};
+    bool main_thread{true};
+    bool exclusive{true};
+    // stepped at the simulation tick by SystemManager::step() instead of every frame
+    bool fixed{false};
+
+    bool conflicts(const Access& other) const noexcept
+    {
+        return exclusive || other.exclusive || (writes & (other.reads | other.writes)).any() ||
+               (other.writes & reads).any();
+    }
+};
+
+template <typename Entity, typename EntityStorageT = EntityStorage<Entity>>
 class System {
 public:
-    using Storage = EntityStorage<Entity>;
+    using Storage  = EntityStorageT;
+    using Access   = ecs::Access<Entity>;
+    using Commands = ecs::Commands<Storage>;
 
     virtual void setup(Storage&) noexcept {};
     virtual void update(Storage&) noexcept {};
 
+    /*
+     * By default system is exclusive and runs on the main thread
+     */
+    virtual Access access() const noexcept
+    {
+        return Access{};
+    }
+
     virtual ~System() = default;
+
+    void attach(rptr<Commands> commands) noexcept
+    {
+        commands_ = commands;
+    }
+
+    /*
+     * Called by SystemManager right before update with the tick the update runs at
+     */
+    void start(Tick tick) noexcept
+    {
+        since_ = now_;
+        now_   = tick;
+    }
+
+protected:
+    /*
+     * Tick of the previous update, use with Added/Changed filters to see what changed since then
+     */
+    Tick since() const noexcept
+    {
+        return since_;
+    }
+
+    /*
+     * Deferred structural changes, applied by SystemManager once all systems finished the frame
+     */
+    CommandBuffer<Storage>& commands() noexcept
+    {
+        return commands_->local();
+    }
+
+    template <typename... Components>
+    static Access::components_t components() noexcept
+    {
+        typename Access::components_t result{0};
+        (result.set(Entity::template index<Components>()), ...);
+        return result;
+    }
+
+private:
+    rptr<Commands> commands_{nullptr};
+    Tick since_{0};
+    Tick now_{0};
 };
 
+/*
+ * Runs systems following a dependency graph built from declared access: a system waits for
+ * every earlier registered system it conflicts with. Fixed systems run in step(), the rest in update().
+ */
 template <typename System>
 class SystemManager {
 public:
     void add(uptr<System> system) noexcept
     {
+        system->attach(&commands_);
         system->setup(storage_);
         systems_.push_back(std::move(system));
     }
 
+    /*
+     * Runs systems declaring fixed access, once per simulation tick
+     */
+    void step()
+    {
+        run_stage(true);
+    }
+
+    /*
+     * Runs the other systems, once per frame
+     */
     void update()
     {
-        for (auto& s : systems_) {
-            s->update(storage_);
-        }
+        run_stage(false);
     }
 
 private:
+    struct Node {
+        typename System::Access access;
+        std::vector<size_t> dependents;
+        size_t dependencies{0};
+        bool active{false};
+    };
+
+    void run_stage(bool fixed)
+    {
+        schedule(fixed);
+
+        for (size_t i = 0; i < systems_.size(); ++i) {
+            if (nodes_[i].active && nodes_[i].dependencies == 0) {
+                dispatch(i);
+            }
+        }
+
+        // the only wait allowed to run main thread systems, nested ones would interleave them
+        jobs::Pool::get()->wait(frame_, jobs::Affinity::main);
+
+        // deferred changes get their own tick, so every system sees them on the next frame
+        storage_.advance();
+        commands_.apply(storage_);
+    }
+
+    void schedule(bool fixed) noexcept
+    {
+        nodes_.resize(systems_.size());
+        if (pending_.size() != systems_.size()) {
+            pending_ = std::vector<std::atomic<size_t>>(systems_.size());
+        }
+
+        for (size_t i = 0; i < systems_.size(); ++i) {
+            nodes_[i].access = systems_[i]->access();
+            nodes_[i].active = nodes_[i].access.fixed == fixed;
+            nodes_[i].dependents.clear();
+            nodes_[i].dependencies = 0;
+
+            for (size_t j = 0; j < i && nodes_[i].active; ++j) {
+                if (nodes_[j].active && nodes_[i].access.conflicts(nodes_[j].access)) {
+                    nodes_[j].dependents.push_back(i);
+                    ++nodes_[i].dependencies;
+                }
+            }
+
+            pending_[i].store(nodes_[i].dependencies, std::memory_order_relaxed);
+        }
+    }
+
+    void dispatch(size_t i) noexcept
+    {
+        jobs::Pool::get()->submit(
+            [this, i]() { run(i); },
+            &frame_,
+            nodes_[i].access.main_thread ? jobs::Affinity::main : jobs::Affinity::any);
+    }
+
+    // Dependents are dispatched before the job completes, so frame_ never drops to zero early
+    void run(size_t i) noexcept
+    {
+        Tick tick = storage_.advance();
+        TickScope scope(tick);
+
+        systems_[i]->start(tick);
+        systems_[i]->update(storage_);
+
+        for (size_t d : nodes_[i].dependents) {
+            if (pending_[d].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                dispatch(d);
+            }
+        }
+    }
+
     std::vector<uptr<System>> systems_;
     System::Storage storage_;
+    System::Commands commands_;
+
+    std::vector<Node> nodes_;
+    std::vector<std::atomic<size_t>> pending_;
+    jobs::Counter frame_;
 };
 
 } // namespace engine::ecs
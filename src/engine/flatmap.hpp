@@ -0,0 +1,165 @@
+#pragma once
+
+#include <bit>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "defines.hpp"
+
+namespace engine {
+
+/*
+ * Open addressing hash map with linear probing, keys and values are stored inline in a single
+ * array. Hashes are scrambled with Fibonacci hashing, so keys that already are hashes work well.
+ * Erasing shifts the following entries back instead of leaving tombstones. Any insert may move
+ * entries, pointers into the map are valid until the next insert or erase.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class FlatMap {
+public:
+    rptr<Value> find(const Key& key) noexcept
+    {
+        if (size_ == 0) {
+            return nullptr;
+        }
+
+        for (size_t i = home(key);; i = (i + 1) & mask()) {
+            Bucket& bucket = buckets_[i];
+
+            if (!bucket.used) {
+                return nullptr;
+            }
+
+            if (bucket.key == key) {
+                return &bucket.value;
+            }
+        }
+    }
+
+    rptr<const Value> find(const Key& key) const noexcept
+    {
+        return const_cast<FlatMap*>(this)->find(key);
+    }
+
+    /*
+     * Inserts the value unless the key is already present, returns whether it did
+     */
+    bool insert(const Key& key, Value value) noexcept
+    {
+        // keeping at most three quarters of buckets used keeps probe sequences short
+        if ((size_ + 1) * 4 > buckets_.size() * 3) {
+            grow();
+        }
+
+        for (size_t i = home(key);; i = (i + 1) & mask()) {
+            Bucket& bucket = buckets_[i];
+
+            if (!bucket.used) {
+                bucket = Bucket{.key = key, .value = std::move(value), .used = true};
+                ++size_;
+                return true;
+            }
+
+            if (bucket.key == key) {
+                return false;
+            }
+        }
+    }
+
+    bool erase(const Key& key) noexcept
+    {
+        if (size_ == 0) {
+            return false;
+        }
+
+        size_t hole = home(key);
+        for (;; hole = (hole + 1) & mask()) {
+            if (!buckets_[hole].used) {
+                return false;
+            }
+
+            if (buckets_[hole].key == key) {
+                break;
+            }
+        }
+
+        // pull back entries whose probe sequence passes through the hole
+        for (size_t i = (hole + 1) & mask(); buckets_[i].used; i = (i + 1) & mask()) {
+            size_t distance = (i - home(buckets_[i].key)) & mask();
+
+            if (distance >= ((i - hole) & mask())) {
+                buckets_[hole] = std::move(buckets_[i]);
+                hole           = i;
+            }
+        }
+
+        buckets_[hole] = Bucket{};
+        --size_;
+
+        return true;
+    }
+
+    template <typename Body>
+    void each(Body&& body) noexcept
+    {
+        for (Bucket& bucket : buckets_) {
+            if (bucket.used) {
+                body(bucket.key, bucket.value);
+            }
+        }
+    }
+
+    template <typename Body>
+    void each(Body&& body) const noexcept
+    {
+        for (const Bucket& bucket : buckets_) {
+            if (bucket.used) {
+                body(bucket.key, bucket.value);
+            }
+        }
+    }
+
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+private:
+    struct Bucket {
+        Key key{};
+        Value value{};
+        bool used{false};
+    };
+
+    size_t mask() const noexcept
+    {
+        return buckets_.size() - 1;
+    }
+
+    size_t home(const Key& key) const noexcept
+    {
+        return static_cast<size_t>((static_cast<u64>(Hash{}(key)) * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    void grow() noexcept
+    {
+        std::vector<Bucket> old = std::move(buckets_);
+
+        buckets_.assign(old.empty() ? 16 : old.size() * 2, Bucket{});
+        shift_ = 64 - static_cast<u32>(std::countr_zero(buckets_.size()));
+        size_  = 0;
+
+        for (Bucket& bucket : old) {
+            if (bucket.used) {
+                insert(bucket.key, std::move(bucket.value));
+            }
+        }
+    }
+
+    std::vector<Bucket> buckets_;
+    size_t size_{0};
+    u32 shift_{64};
+};
+
+} // namespace engine
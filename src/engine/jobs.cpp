@@ -0,0 +1,195 @@
+#include "jobs.hpp"
+
+namespace engine::jobs {
+
+static thread_local size_t thread_index_ = 0;
+
+// static initialization runs on the main thread, before anything could create a pool
+static const std::thread::id main_thread_ = std::this_thread::get_id();
+
+uptr<Pool> Pool::instance_ = nullptr;
+
+rptr<Pool> Pool::get()
+{
+    static std::once_flag once;
+    std::call_once(once, []() {
+        size_t hardware = std::thread::hardware_concurrency();
+        instance_       = std::make_unique<Pool>(hardware > 1 ? hardware - 1 : 0);
+    });
+
+    return instance_.get();
+}
+
+Pool::Pool(size_t workers) noexcept
+    : main_id_(main_thread_)
+{
+    for (size_t i = 0; i <= workers; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+
+    for (size_t i = 1; i <= workers; ++i) {
+        threads_.emplace_back([this, i]() { work(i); });
+    }
+}
+
+Pool::~Pool()
+{
+    {
+        std::lock_guard lock(sleep_mutex_);
+        stop_ = true;
+    }
+
+    sleep_cv_.notify_all();
+
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+void Pool::submit(job_t job, rptr<Counter> counter, Affinity affinity) noexcept
+{
+    if (counter) {
+        counter->add(1);
+    }
+
+    if (affinity == Affinity::main) {
+        std::lock_guard lock(main_.mutex);
+        main_.jobs.push_back(Job{std::move(job), counter});
+        return;
+    }
+
+    pending_.fetch_add(1, std::memory_order_release);
+
+    {
+        Queue& queue = *queues_[thread_index_];
+        std::lock_guard lock(queue.mutex);
+        queue.jobs.push_back(Job{std::move(job), counter});
+    }
+
+    // empty critical section orders the notification after a worker's predicate check
+    {
+        std::lock_guard lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+}
+
+void Pool::wait(Counter& counter, Affinity affinity) noexcept
+{
+    bool main = affinity == Affinity::main && std::this_thread::get_id() == main_id_;
+
+    while (!counter.ready()) {
+        if (main) {
+            pump();
+        }
+
+        Job job;
+        if (next(thread_index_, job)) {
+            execute(job);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void Pool::pump() noexcept
+{
+    while (true) {
+        Job job;
+
+        {
+            std::lock_guard lock(main_.mutex);
+            if (main_.jobs.empty()) {
+                return;
+            }
+
+            job = std::move(main_.jobs.front());
+            main_.jobs.pop_front();
+        }
+
+        execute(job);
+    }
+}
+
+size_t Pool::workers() const noexcept
+{
+    return threads_.size();
+}
+
+size_t Pool::thread_index() noexcept
+{
+    return thread_index_;
+}
+
+void Pool::work(size_t index) noexcept
+{
+    thread_index_ = index;
+
+    while (true) {
+        Job job;
+
+        if (next(index, job)) {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this]() { return stop_ || pending_.load(std::memory_order_acquire) > 0; });
+
+        if (stop_) {
+            return;
+        }
+    }
+}
+
+bool Pool::pop(size_t index, Job& job) noexcept
+{
+    Queue& queue = *queues_[index];
+    std::lock_guard lock(queue.mutex);
+
+    if (queue.jobs.empty()) {
+        return false;
+    }
+
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+
+    return true;
+}
+
+bool Pool::steal(size_t index, Job& job) noexcept
+{
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        Queue& queue = *queues_[(index + i) % queues_.size()];
+        std::lock_guard lock(queue.mutex);
+
+        if (!queue.jobs.empty()) {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Pool::next(size_t index, Job& job) noexcept
+{
+    if (pop(index, job) || steal(index, job)) {
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    return false;
+}
+
+void Pool::execute(Job& job) noexcept
+{
+    job.job();
+
+    if (job.counter) {
+        job.counter->done();
+    }
+}
+
+} // namespace engine::jobs
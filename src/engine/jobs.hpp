@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "defines.hpp"
+
+namespace engine::jobs {
+
+using job_t = std::function<void()>;
+
+/*
+ * Number of unfinished jobs attached to it, used to express dependencies and to wait
+ */
+class Counter {
+public:
+    void add(size_t count) noexcept
+    {
+        value_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    void done() noexcept
+    {
+        value_.fetch_sub(1, std::memory_order_release);
+    }
+
+    bool ready() const noexcept
+    {
+        return value_.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    std::atomic<size_t> value_{0};
+};
+
+enum class Affinity {
+    any,
+    main,
+};
+
+/*
+ * Fixed set of worker threads, each owning a deque: owner pushes and pops at the back,
+ * idle workers steal from the front of other deques. Jobs submitted from outside of
+ * the pool go to a shared injection deque, main affinity jobs only run on the main thread
+ * of the process while it waits or pumps, whichever thread created the pool.
+ */
+class Pool {
+public:
+    Pool(size_t workers) noexcept;
+
+    ~Pool();
+
+    void submit(job_t job, rptr<Counter> counter = nullptr, Affinity affinity = Affinity::any) noexcept;
+
+    /*
+     * Executes pending jobs on the calling thread until counter is ready. Only the top level wait
+     * of the main thread passes Affinity::main to also run main affinity jobs, a wait nested in
+     * a job must not start other main thread work in the middle of it.
+     */
+    void wait(Counter& counter, Affinity affinity = Affinity::any) noexcept;
+
+    /*
+     * Executes all pending main affinity jobs, has to be called from the main thread
+     */
+    void pump() noexcept;
+
+    /*
+     * Calls body(begin, end) for subranges of at most grain indices and waits for completion
+     */
+    template <typename Body>
+    void parallel_for(size_t begin, size_t end, size_t grain, Body&& body) noexcept
+    {
+        Counter counter;
+        grain = std::max<size_t>(grain, 1);
+
+        for (size_t from = begin; from < end; from += grain) {
+            size_t to = std::min(end, from + grain);
+            submit([&body, from, to]() { body(from, to); }, &counter);
+        }
+
+        wait(counter);
+    }
+
+    size_t workers() const noexcept;
+
+    /*
+     * 0 for threads outside of the pool, 1..workers() for workers
+     */
+    static size_t thread_index() noexcept;
+
+    static rptr<Pool> get();
+
+private:
+    static uptr<Pool> instance_;
+
+    struct Job {
+        job_t job;
+        rptr<Counter> counter;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void work(size_t index) noexcept;
+
+    bool pop(size_t index, Job& job) noexcept;
+
+    bool steal(size_t index, Job& job) noexcept;
+
+    bool next(size_t index, Job& job) noexcept;
+
+    void execute(Job& job) noexcept;
+
+    std::vector<std::thread> threads_;
+    std::vector<uptr<Queue>> queues_;
+    Queue main_;
+    std::thread::id main_id_;
+
+    std::atomic<size_t> pending_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    bool stop_{false};
+};
+
+} // namespace engine::jobs
@@ -0,0 +1,103 @@
+#include "loader.hpp"
+
+namespace engine {
+
+LoadHandle LoadHandle::create(LoadState state) noexcept
+{
+    LoadHandle handle;
+    handle.state_ = std::make_shared<std::atomic<LoadState>>(state);
+
+    return handle;
+}
+
+LoadState LoadHandle::state() const noexcept
+{
+    return state_ ? state_->load(std::memory_order_acquire) : LoadState::failed;
+}
+
+bool LoadHandle::pending() const noexcept
+{
+    return state() == LoadState::pending;
+}
+
+bool LoadHandle::ready() const noexcept
+{
+    return state() == LoadState::ready;
+}
+
+bool LoadHandle::failed() const noexcept
+{
+    return state() == LoadState::failed;
+}
+
+void LoadHandle::resolve(bool ok) const noexcept
+{
+    state_->store(ok ? LoadState::ready : LoadState::failed, std::memory_order_release);
+}
+
+uptr<Loader> Loader::instance_ = nullptr;
+
+rptr<Loader> Loader::get()
+{
+    if (!instance_) {
+        // decoding is mostly waiting on the disk, a couple of threads keep it busy
+        instance_ = std::make_unique<Loader>(2);
+    }
+
+    return instance_.get();
+}
+
+Loader::Loader(size_t threads) noexcept
+{
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this]() { work(); });
+    }
+}
+
+Loader::~Loader()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+
+    cv_.notify_all();
+
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+void Loader::submit(jobs::job_t task) noexcept
+{
+    {
+        std::lock_guard lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+
+    cv_.notify_one();
+}
+
+void Loader::work() noexcept
+{
+    while (true) {
+        jobs::job_t task;
+
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+
+            // unstarted tasks are dropped, their inboxes just never hear back
+            if (stop_) {
+                return;
+            }
+
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        task();
+    }
+}
+
+} // namespace engine
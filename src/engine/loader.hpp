@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "defines.hpp"
+#include "jobs.hpp"
+
+namespace engine {
+
+enum class LoadState : u8 {
+    pending,
+    ready,
+    failed,
+};
+
+/*
+ * Progress of an asynchronous load, shared between the holder and its callers
+ */
+class LoadHandle {
+public:
+    static LoadHandle create(LoadState state = LoadState::pending) noexcept;
+
+    LoadState state() const noexcept;
+
+    bool pending() const noexcept;
+
+    bool ready() const noexcept;
+
+    bool failed() const noexcept;
+
+    /*
+     * Called by the holder once the asset is uploaded or failed to load
+     */
+    void resolve(bool ok) const noexcept;
+
+private:
+    sptr<std::atomic<LoadState>> state_;
+};
+
+/*
+ * Background threads for file reads and decoding. They are kept apart from the job pool,
+ * so a slow disk read never ends up on a thread the frame is waiting for.
+ */
+class Loader {
+public:
+    Loader(size_t threads) noexcept;
+
+    ~Loader();
+
+    void submit(jobs::job_t task) noexcept;
+
+    static rptr<Loader> get();
+
+    static uptr<Loader> instance_;
+
+private:
+    void work() noexcept;
+
+    std::vector<std::thread> threads_;
+    std::deque<jobs::job_t> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_{false};
+};
+
+/*
+ * Decoded assets waiting for the main thread. Tasks hold it by a shared pointer, so the holder
+ * can be destroyed while decoding is in flight; whatever is left is released with it.
+ */
+template <typename Decoded>
+class Inbox {
+public:
+    void push(Decoded decoded) noexcept
+    {
+        std::lock_guard lock(mutex_);
+        items_.push_back(std::move(decoded));
+    }
+
+    bool pop(Decoded& decoded) noexcept
+    {
+        std::lock_guard lock(mutex_);
+
+        if (items_.empty()) {
+            return false;
+        }
+
+        decoded = std::move(items_.front());
+        items_.pop_front();
+
+        return true;
+    }
+
+    ~Inbox()
+    {
+        for (Decoded& decoded : items_) {
+            decoded.release();
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<Decoded> items_;
+};
+
+} // namespace engine
@@ -0,0 +1,192 @@
+#include "mixer.hpp"
+
+#include <algorithm>
+
+namespace engine {
+
+uptr<Mixer> Mixer::instance_ = nullptr;
+
+rptr<Mixer> Mixer::get()
+{
+    if (!instance_) {
+        // stream buffers hold tens of milliseconds, refilling every few keeps well ahead of the device
+        instance_ = std::make_unique<Mixer>(std::chrono::milliseconds(4));
+    }
+
+    return instance_.get();
+}
+
+Mixer::Mixer(std::chrono::microseconds period) noexcept
+    : period_(period)
+{
+}
+
+Mixer::~Mixer()
+{
+    close();
+}
+
+void Mixer::open() noexcept
+{
+    if (running_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    running_.store(true, std::memory_order_release);
+    thread_ = std::thread([this]() { work(); });
+}
+
+void Mixer::close() noexcept
+{
+    if (!running_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    thread_.join();
+
+    for (const Music& music : voices_) {
+        StopMusicStream(music);
+    }
+
+    voices_.clear();
+
+    // whatever was posted after the thread left is dropped
+    head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
+    applied_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
+    applied_.notify_all();
+}
+
+void Mixer::play(const Music& music) noexcept
+{
+    post(MixerAction::play, music, 0.0f);
+}
+
+void Mixer::stop(const Music& music) noexcept
+{
+    post(MixerAction::stop, music, 0.0f);
+}
+
+void Mixer::volume(const Music& music, f32 volume) noexcept
+{
+    post(MixerAction::volume, music, volume);
+}
+
+void Mixer::seek(const Music& music, f32 seconds) noexcept
+{
+    post(MixerAction::seek, music, seconds);
+}
+
+void Mixer::apply(MixerState& state, const Music& music, bool playing, f32 volume) noexcept
+{
+    if (state.music.stream.buffer != music.stream.buffer) {
+        state = MixerState{.music = music, .playing = false, .volume = 1.0f};
+    }
+
+    if (music.stream.buffer == nullptr) {
+        return;
+    }
+
+    if (state.volume != volume) {
+        this->volume(music, volume);
+        state.volume = volume;
+    }
+
+    if (state.playing != playing) {
+        playing ? play(music) : stop(music);
+        state.playing = playing;
+    }
+}
+
+void Mixer::sync() noexcept
+{
+    u64 target = tail_.load(std::memory_order_relaxed);
+    u64 seen   = applied_.load(std::memory_order_acquire);
+
+    while (seen < target && running_.load(std::memory_order_acquire)) {
+        applied_.wait(seen, std::memory_order_acquire);
+        seen = applied_.load(std::memory_order_acquire);
+    }
+}
+
+bool Mixer::running() const noexcept
+{
+    return running_.load(std::memory_order_acquire);
+}
+
+void Mixer::post(MixerAction action, const Music& music, f32 value) noexcept
+{
+    if (music.stream.buffer == nullptr || !running_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    u64 tail = tail_.load(std::memory_order_relaxed);
+
+    // the thread drains the queue every period, a full queue only ever waits that long
+    while (tail - head_.load(std::memory_order_acquire) >= capacity) {
+        if (!running_.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        std::this_thread::yield();
+    }
+
+    commands_[tail % capacity] = MixerCommand{.action = action, .music = music, .value = value};
+    tail_.store(tail + 1, std::memory_order_release);
+}
+
+void Mixer::work() noexcept
+{
+    while (running_.load(std::memory_order_acquire)) {
+        u64 head = head_.load(std::memory_order_relaxed);
+        u64 tail = tail_.load(std::memory_order_acquire);
+
+        for (; head != tail; ++head) {
+            execute(commands_[head % capacity]);
+        }
+
+        head_.store(head, std::memory_order_release);
+
+        for (const Music& music : voices_) {
+            UpdateMusicStream(music);
+        }
+
+        // published after the refill, so a synced stream is not touched anymore
+        applied_.store(head, std::memory_order_release);
+        applied_.notify_all();
+
+        std::this_thread::sleep_for(period_);
+    }
+
+    // wake a sync() that raced with close()
+    applied_.notify_all();
+}
+
+void Mixer::execute(const MixerCommand& command) noexcept
+{
+    auto voice = std::find_if(voices_.begin(), voices_.end(), [&command](const Music& music) {
+        return music.stream.buffer == command.music.stream.buffer;
+    });
+
+    switch (command.action) {
+    case MixerAction::play:
+        if (voice == voices_.end()) {
+            PlayMusicStream(command.music);
+            voices_.push_back(command.music);
+        }
+        break;
+    case MixerAction::stop:
+        if (voice != voices_.end()) {
+            StopMusicStream(*voice);
+            voices_.erase(voice);
+        }
+        break;
+    case MixerAction::volume:
+        SetMusicVolume(command.music, command.value);
+        break;
+    case MixerAction::seek:
+        SeekMusicStream(command.music, command.value);
+        break;
+    }
+}
+
+} // namespace engine
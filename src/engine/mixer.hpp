@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "defines.hpp"
+
+namespace engine {
+
+enum class MixerAction : u8 {
+    play,
+    stop,
+    volume,
+    seek,
+};
+
+struct MixerCommand {
+    MixerAction action{MixerAction::stop};
+    Music music{};
+    f32 value{0.0f};
+};
+
+/*
+ * What was last posted for a stream, so callers post changes instead of the whole state every frame
+ */
+struct MixerState {
+    Music music{};
+    bool playing{false};
+    f32 volume{1.0f};
+};
+
+/*
+ * Audio thread that owns playing music streams: it applies posted commands and refills stream
+ * buffers every period, independent of the frame rate, so long frames never starve the device.
+ * Commands go through a lock-free single producer queue, post from the main thread only.
+ * Streams are identified by their audio buffer, unload one only after stop() and sync().
+ */
+class Mixer {
+public:
+    Mixer(std::chrono::microseconds period) noexcept;
+
+    ~Mixer();
+
+    /*
+     * Starts the thread, the audio device has to be initialized
+     */
+    void open() noexcept;
+
+    /*
+     * Stops all streams and the thread, call before the audio device is closed
+     */
+    void close() noexcept;
+
+    void play(const Music& music) noexcept;
+
+    void stop(const Music& music) noexcept;
+
+    void volume(const Music& music, f32 volume) noexcept;
+
+    void seek(const Music& music, f32 seconds) noexcept;
+
+    /*
+     * Posts whatever differs between state and the wanted one and updates state. A stream that
+     * changed identity starts over, the old one has been stopped by whoever unloaded it.
+     */
+    void apply(MixerState& state, const Music& music, bool playing, f32 volume) noexcept;
+
+    /*
+     * Waits until commands posted so far are applied and the thread let go of stopped streams
+     */
+    void sync() noexcept;
+
+    bool running() const noexcept;
+
+    static rptr<Mixer> get();
+
+    static uptr<Mixer> instance_;
+
+private:
+    static constexpr size_t capacity = 256;
+
+    void post(MixerAction action, const Music& music, f32 value) noexcept;
+
+    void work() noexcept;
+
+    void execute(const MixerCommand& command) noexcept;
+
+    std::array<MixerCommand, capacity> commands_;
+    alignas(64) std::atomic<u64> head_{0};
+    alignas(64) std::atomic<u64> tail_{0};
+    alignas(64) std::atomic<u64> applied_{0};
+    std::atomic<bool> running_{false};
+    std::chrono::microseconds period_;
+    std::vector<Music> voices_;
+    std::thread thread_;
+};
+
+} // namespace engine
@@ -0,0 +1,47 @@
+#include "names.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace engine {
+
+#ifndef NDEBUG
+
+namespace {
+
+std::mutex& names_mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::unordered_map<u64, string>& names()
+{
+    static std::unordered_map<u64, string> names;
+    return names;
+}
+
+} // namespace
+
+cstr StringId::intern(u64 hash, std::string_view text) noexcept
+{
+    std::lock_guard lock(names_mutex());
+
+    auto [name, inserted] = names().try_emplace(hash, text);
+    assert(name->second == text && "StringId hash collision");
+
+    // nodes never move, the text stays valid for the rest of the run
+    return name->second.c_str();
+}
+
+cstr StringId::lookup(u64 hash) noexcept
+{
+    std::lock_guard lock(names_mutex());
+
+    auto name = names().find(hash);
+    return name == names().end() ? "" : name->second.c_str();
+}
+
+#endif
+
+} // namespace engine
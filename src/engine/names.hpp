@@ -0,0 +1,101 @@
+#pragma once
+
+#include <functional>
+#include <string_view>
+#include <type_traits>
+
+#include "defines.hpp"
+
+namespace engine {
+
+/*
+ * Name reduced to its 64-bit FNV-1a hash, so lookups and compares are a single integer compare.
+ * Names written as "player"_sid are hashed at compile time. Debug builds keep the text of every
+ * name in a reverse lookup table and assert on hash collisions; release builds only keep the hash.
+ */
+class StringId {
+public:
+    constexpr StringId() noexcept = default;
+
+    constexpr StringId(std::string_view text) noexcept
+        : hash_(hash(text))
+    {
+#ifndef NDEBUG
+        text_ = std::is_constant_evaluated() ? text.data() : intern(hash_, text);
+#endif
+    }
+
+    constexpr StringId(cstr text) noexcept
+        : StringId(std::string_view(text))
+    {
+    }
+
+    StringId(const string& text) noexcept
+        : StringId(std::string_view(text))
+    {
+    }
+
+    constexpr u64 value() const noexcept
+    {
+        return hash_;
+    }
+
+    /*
+     * Text the name was made from in debug builds, an empty string in release builds
+     */
+    cstr str() const noexcept
+    {
+#ifndef NDEBUG
+        return text_ ? text_ : lookup(hash_);
+#else
+        return "";
+#endif
+    }
+
+    constexpr bool operator==(const StringId& other) const noexcept
+    {
+        return hash_ == other.hash_;
+    }
+
+    static constexpr u64 hash(std::string_view text) noexcept
+    {
+        u64 value = 14695981039346656037ull;
+
+        for (char c : text) {
+            value ^= static_cast<u8>(c);
+            value *= 1099511628211ull;
+        }
+
+        return value;
+    }
+
+private:
+#ifndef NDEBUG
+    static cstr intern(u64 hash, std::string_view text) noexcept;
+
+    static cstr lookup(u64 hash) noexcept;
+
+    cstr text_{nullptr};
+#endif
+
+    u64 hash_{0};
+};
+
+namespace literals {
+
+consteval StringId operator""_sid(cstr text, size_t size)
+{
+    return StringId(std::string_view(text, size));
+}
+
+} // namespace literals
+
+} // namespace engine
+
+template <>
+struct std::hash<engine::StringId> {
+    size_t operator()(const engine::StringId& id) const noexcept
+    {
+        return static_cast<size_t>(id.value());
+    }
+};
@@ -0,0 +1,97 @@
+#include "overlay.hpp"
+
+#include <algorithm>
+
+#include "fmt/format.h"
+
+namespace engine {
+
+namespace {
+
+constexpr i32 bar_width    = 2;
+constexpr i32 graph_height = 100;
+constexpr i32 font_size    = 10;
+constexpr i32 line_height  = 12;
+
+} // namespace
+
+ProfilerOverlay::ProfilerOverlay(size_t scopes) noexcept
+    : scopes_(scopes)
+{
+}
+
+void ProfilerOverlay::toggle() noexcept
+{
+    visible_ = !visible_;
+}
+
+bool ProfilerOverlay::visible() const noexcept
+{
+    return visible_;
+}
+
+void ProfilerOverlay::draw(i32 x, i32 y) noexcept
+{
+#if PROFILING == 1
+    if (!visible_) {
+        return;
+    }
+
+    AutomaticProfilerRegister::get()->snapshot(snapshot_);
+
+    graph(x, y);
+    table(x, y + graph_height + line_height);
+#else
+    (void)x;
+    (void)y;
+#endif
+}
+
+void ProfilerOverlay::graph(i32 x, i32 y) noexcept
+{
+    elapsed_t budget = AutomaticProfilerRegister::get()->budget();
+    elapsed_t top    = 2.0 * budget;
+
+    for (elapsed_t frame : snapshot_.frames) {
+        top = std::max(top, frame);
+    }
+
+    i32 width = AutomaticProfilerRegister::window_frames * bar_width;
+    DrawRectangle(x, y, width, graph_height, Color{.r = 0, .g = 0, .b = 0, .a = 160});
+
+    // newest frame on the right edge
+    i32 bar = x + width - static_cast<i32>(snapshot_.frames.size()) * bar_width;
+    for (elapsed_t frame : snapshot_.frames) {
+        i32 height = static_cast<i32>(frame / top * graph_height);
+        DrawRectangle(bar, y + graph_height - height, bar_width, height, frame > budget ? RED : GREEN);
+        bar += bar_width;
+    }
+
+    i32 line = y + graph_height - static_cast<i32>(budget / top * graph_height);
+    DrawLine(x, line, x + width, line, YELLOW);
+
+    elapsed_t last = snapshot_.frames.empty() ? 0.0 : snapshot_.frames.back();
+    line_          = fmt::format("frame {:.2f} ms, budget {:.2f} ms", last * 1000.0, budget * 1000.0);
+    DrawText(line_.c_str(), x + 2, y + 2, font_size, WHITE);
+}
+
+void ProfilerOverlay::table(i32 x, i32 y) noexcept
+{
+    size_t count = std::min(scopes_, snapshot_.scopes.size());
+
+    DrawRectangle(
+        x,
+        y,
+        AutomaticProfilerRegister::window_frames * bar_width,
+        static_cast<i32>(count) * line_height + 4,
+        Color{.r = 0, .g = 0, .b = 0, .a = 160});
+
+    for (size_t i = 0; i < count; ++i) {
+        auto& [name, elapsed] = snapshot_.scopes[i];
+
+        line_ = fmt::format("{:8.3f} ms  {}", elapsed * 1000.0, name);
+        DrawText(line_.c_str(), x + 2, y + 2 + static_cast<i32>(i) * line_height, font_size, WHITE);
+    }
+}
+
+} // namespace engine
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "defines.hpp"
+#include "profiling.hpp"
+
+namespace engine {
+
+/*
+ * In-game view of the profiler: rolling frame time graph against the frame budget
+ * and the most expensive scopes over the last AutomaticProfilerRegister::window_frames
+ */
+class ProfilerOverlay {
+public:
+    ProfilerOverlay(size_t scopes = 8) noexcept;
+
+    void toggle() noexcept;
+
+    bool visible() const noexcept;
+
+    /*
+     * Draws in screen space, must be called between BeginDrawing and EndDrawing
+     */
+    void draw(i32 x, i32 y) noexcept;
+
+private:
+    void graph(i32 x, i32 y) noexcept;
+
+    void table(i32 x, i32 y) noexcept;
+
+    size_t scopes_{0};
+    bool visible_{false};
+    AutomaticProfilerSnapshot snapshot_;
+    string line_;
+};
+
+} // namespace engine
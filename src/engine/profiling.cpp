@@ -1,61 +1,409 @@
 #include "profiling.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
 
 namespace engine {
 
+static constexpr auto collect_period = std::chrono::milliseconds(5);
+
+static thread_local rptr<AutomaticProfilerBuffer> buffer_ = nullptr;
+static thread_local u32 thread_depth_                     = 0;
+
 uptr<AutomaticProfilerRegister> AutomaticProfilerRegister::instance_ = nullptr;
 
-rptr<AutomaticProfilerRegister> AutomaticProfilerRegister::get()
+size_t AutomaticProfilerHistogram::index(u64 ns) noexcept
+{
+    if (ns < 2 * sub_count) {
+        return ns;
+    }
+
+    size_t shift = std::bit_width(ns) - sub_bits - 1;
+    return std::min((shift + 1) * sub_count + ((ns >> shift) - sub_count), buckets - 1);
+}
+
+u64 AutomaticProfilerHistogram::upper(size_t index) noexcept
+{
+    if (index < 2 * sub_count) {
+        return index;
+    }
+
+    size_t shift = index / sub_count - 1;
+    u64 sub      = index % sub_count + sub_count;
+    return ((sub + 1) << shift) - 1;
+}
+
+void AutomaticProfilerHistogram::add(u64 ns) noexcept
+{
+    ++counts_[index(ns)];
+    ++count_;
+}
+
+u64 AutomaticProfilerHistogram::quantile(f64 q) const noexcept
+{
+    size_t target = static_cast<size_t>(q * count_);
+    size_t seen   = 0;
+
+    for (size_t i = 0; i < buckets; ++i) {
+        seen += counts_[i];
+        if (seen > target) {
+            return upper(i);
+        }
+    }
+
+    return 0;
+}
+
+size_t AutomaticProfilerHistogram::count() const noexcept
 {
-    if (!instance_) {
-        instance_ = std::make_unique<AutomaticProfilerRegister>();
+    return count_;
+}
+
+void AutomaticProfilerEntry::add(elapsed_t sample, elapsed_t budget) noexcept
+{
+    min = count == 0 ? sample : std::min(min, sample);
+    max = std::max(max, sample);
+    elapsed += sample;
+    count += 1;
+    over_budget += sample > budget ? 1 : 0;
+    // out of range doubles make the cast undefined
+    histogram.add(static_cast<u64>(std::clamp(sample * 1e9, 0.0, 0x1p63)));
+}
+
+AutomaticProfilerStats AutomaticProfilerEntry::stats() const noexcept
+{
+    if (count == 0) {
+        return AutomaticProfilerStats{};
     }
 
+    // bucket bounds may overshoot the exact extremes, clamp them
+    auto quantile = [this](f64 q) { return std::clamp(histogram.quantile(q) * 1e-9, min, max); };
+
+    return AutomaticProfilerStats{
+        .count       = count,
+        .mean        = elapsed / count,
+        .min         = min,
+        .max         = max,
+        .p50         = quantile(0.5),
+        .p95         = quantile(0.95),
+        .p99         = quantile(0.99),
+        .p999        = quantile(0.999),
+        .over_budget = over_budget};
+}
+
+rptr<AutomaticProfilerRegister> AutomaticProfilerRegister::get()
+{
+    static std::once_flag once;
+    std::call_once(once, []() { instance_ = std::make_unique<AutomaticProfilerRegister>(); });
+
     return instance_.get();
 }
 
-void AutomaticProfilerRegister::add(cstr name, time_t begin, time_t end)
+AutomaticProfilerRegister::AutomaticProfilerRegister()
+    : epoch_(std::chrono::steady_clock::now())
+{
+    collector_ = std::thread([this]() {
+        std::unique_lock lock(collector_mutex_);
+
+        while (!collector_cv_.wait_for(lock, collect_period, [this]() { return stop_; })) {
+            collect();
+        }
+    });
+}
+
+void AutomaticProfilerRegister::add(cstr name, StringId id, time_t begin, time_t end, u32 depth)
+{
+    local()->push(AutomaticProfilerRecord{name, id, begin, end, depth, false});
+}
+
+void AutomaticProfilerRegister::frame()
+{
+    time_t now = std::chrono::steady_clock::now();
+    local()->push(AutomaticProfilerRecord{"frame", StringId(), now, now, 0, true});
+}
+
+rptr<AutomaticProfilerBuffer> AutomaticProfilerRegister::local()
+{
+    if (!buffer_) {
+        std::lock_guard lock(buffers_mutex_);
+        buffers_.push_back(std::make_unique<AutomaticProfilerBuffer>());
+        buffer_ = buffers_.back().get();
+    }
+
+    return buffer_;
+}
+
+void AutomaticProfilerRegister::collect()
+{
+    std::lock_guard collect_lock(collect_mutex_);
+    std::lock_guard buffers_lock(buffers_mutex_);
+
+    elapsed_t budget = budget_.load(std::memory_order_relaxed);
+    size_t frames    = frames_.count;
+    last_frame_.resize(buffers_.size());
+
+    for (size_t thread = 0; thread < buffers_.size(); ++thread) {
+        buffers_[thread]->drain([this, thread, budget](const AutomaticProfilerRecord& record) {
+            if (timeline_.size() == trace_capacity) {
+                timeline_.pop_front();
+            }
+            timeline_.push_back(AutomaticProfilerTraceEvent{record, thread});
+
+            if (record.frame) {
+                if (last_frame_[thread] != time_t{}) {
+                    std::chrono::duration<elapsed_t> frame = record.begin - last_frame_[thread];
+                    frames_.add(frame.count(), budget);
+
+                    for (auto& [id, elapsed] : window_current_) {
+                        window_totals_[id] += elapsed;
+                    }
+                    window_.push_back(Window{frame.count(), std::move(window_current_)});
+                    window_current_.clear();
+
+                    if (window_.size() > window_frames) {
+                        for (auto& [id, elapsed] : window_.front().scopes) {
+                            window_totals_[id] -= elapsed;
+                        }
+                        window_.pop_front();
+                    }
+                }
+
+                last_frame_[thread] = record.begin;
+                return;
+            }
+
+            std::chrono::duration<elapsed_t> diff = record.end - record.begin;
+            AutomaticProfilerEntry& entry = measurements_[record.id];
+            entry.name                    = record.name;
+            entry.add(diff.count(), budget);
+            window_current_[record.id] += diff.count();
+        });
+    }
+
+    if (frames_.count != frames) {
+        publish();
+    }
+}
+
+void AutomaticProfilerRegister::publish()
+{
+    AutomaticProfilerSnapshot snapshot;
+
+    snapshot.frames.reserve(window_.size());
+    for (auto& window : window_) {
+        snapshot.frames.push_back(window.frame);
+    }
+
+    snapshot.scopes.reserve(window_totals_.size());
+    for (auto& [id, elapsed] : window_totals_) {
+        snapshot.scopes.emplace_back(measurements_[id].name, std::max(elapsed, 0.0) / window_.size());
+    }
+
+    std::sort(snapshot.scopes.begin(), snapshot.scopes.end(), [](auto& a, auto& b) { return a.second > b.second; });
+
+    std::lock_guard lock(snapshot_mutex_);
+    std::swap(snapshot_, snapshot);
+}
+
+void AutomaticProfilerRegister::reset()
+{
+    collect();
+
+    std::lock_guard lock(collect_mutex_);
+
+    measurements_.clear();
+    frames_ = AutomaticProfilerEntry{};
+    last_frame_.clear();
+    window_.clear();
+    window_current_.clear();
+    window_totals_.clear();
+}
+
+void AutomaticProfilerRegister::snapshot(AutomaticProfilerSnapshot& snapshot)
+{
+    std::lock_guard lock(snapshot_mutex_);
+
+    snapshot.frames.assign(snapshot_.frames.begin(), snapshot_.frames.end());
+    snapshot.scopes.assign(snapshot_.scopes.begin(), snapshot_.scopes.end());
+}
+
+void AutomaticProfilerRegister::budget(elapsed_t seconds)
+{
+    budget_.store(seconds, std::memory_order_relaxed);
+}
+
+elapsed_t AutomaticProfilerRegister::budget() const noexcept
+{
+    return budget_.load(std::memory_order_relaxed);
+}
+
+AutomaticProfilerStats AutomaticProfilerRegister::stats(cstr name)
+{
+    collect();
+
+    std::lock_guard lock(collect_mutex_);
+
+    auto found = measurements_.find(StringId(name));
+    return found == measurements_.end() ? AutomaticProfilerStats{} : found->second.stats();
+}
+
+std::vector<std::pair<cstr, AutomaticProfilerStats>> AutomaticProfilerRegister::stats()
+{
+    collect();
+
+    std::lock_guard lock(collect_mutex_);
+
+    std::vector<std::pair<cstr, AutomaticProfilerStats>> result;
+    result.reserve(measurements_.size());
+
+    for (auto& [id, entry] : measurements_) {
+        result.emplace_back(entry.name, entry.stats());
+    }
+
+    return result;
+}
+
+AutomaticProfilerStats AutomaticProfilerRegister::frames()
+{
+    collect();
+
+    std::lock_guard lock(collect_mutex_);
+    return frames_.stats();
+}
+
+static void write_escaped(std::ostream& out, cstr text)
+{
+    for (; *text; ++text) {
+        if (*text == '"' || *text == '\\') {
+            out << '\\';
+        }
+        out << *text;
+    }
+}
+
+size_t AutomaticProfilerRegister::dropped()
 {
-    std::chrono::duration<elapsed_t> diff = end - begin;
+    std::lock_guard lock(buffers_mutex_);
 
-    if (measurements_.contains(name)) {
-        measurements_[name].elapsed += diff.count();
-        measurements_[name].count += 1;
+    size_t dropped = 0;
+    for (auto& buffer : buffers_) {
+        dropped += buffer->dropped();
     }
-    else {
-        measurements_[name].elapsed = diff.count();
-        measurements_[name].count   = 1;
+
+    return dropped;
+}
+
+bool AutomaticProfilerRegister::trace(cstr path)
+{
+    collect();
+
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+
+    std::lock_guard lock(collect_mutex_);
+
+    auto us = [this](time_t t) { return std::chrono::duration<f64, std::micro>(t - epoch_).count(); };
+
+    out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    for (const AutomaticProfilerTraceEvent& event : timeline_) {
+        const AutomaticProfilerRecord& r = event.record;
+
+        out << (first ? "\n" : ",\n") << "{\"name\":\"";
+        write_escaped(out, r.name);
+
+        if (r.frame) {
+            out << "\",\"ph\":\"i\",\"s\":\"g\",\"ts\":" << us(r.begin);
+        }
+        else {
+            out << "\",\"ph\":\"X\",\"ts\":" << us(r.begin) << ",\"dur\":" << us(r.end) - us(r.begin)
+                << ",\"args\":{\"depth\":" << r.depth << "}";
+        }
+
+        out << ",\"pid\":0,\"tid\":" << event.thread << "}";
+        first = false;
     }
+
+    out << "\n]}\n";
+
+    return out.good();
 }
 
 AutomaticProfilerRegister::~AutomaticProfilerRegister()
 {
-    std::map<elapsed_t, cstr> results;
+    {
+        std::lock_guard lock(collector_mutex_);
+        stop_ = true;
+    }
+
+    collector_cv_.notify_all();
+    collector_.join();
+
+    collect();
+
+    if (cstr path = std::getenv("PROFILE_TRACE"); path) {
+        trace(path);
+    }
+
+    std::multimap<elapsed_t, std::pair<cstr, AutomaticProfilerStats>> results;
+    size_t dropped = 0;
+
+    for (auto& [id, entry] : measurements_) {
+        AutomaticProfilerStats stats = entry.stats();
+        results.emplace(stats.mean, std::make_pair(entry.name, stats));
+    }
+
+    for (auto& buffer : buffers_) {
+        dropped += buffer->dropped();
+    }
+
+    auto row = [](const AutomaticProfilerStats& stats, const std::string& name) {
+        std::cout << std::fixed;
+        for (elapsed_t value : {stats.mean, stats.p50, stats.p95, stats.p99, stats.p999, stats.max}) {
+            std::cout << std::setw(13) << value * 1000.0;
+        }
+        std::cout << std::setw(13) << stats.over_budget << " :\t" << name << std::endl;
+    };
+
+    std::cout << "Brief stats per frame, ms (budget " << budget_.load() * 1000.0 << " ms):" << std::endl;
+    std::cout << std::setw(13) << "mean" << std::setw(13) << "p50" << std::setw(13) << "p95" << std::setw(13)
+              << "p99" << std::setw(13) << "p99.9" << std::setw(13) << "max" << std::setw(13) << "over budget"
+              << std::endl;
+
+    for (auto& [mean, result] : results) {
+        row(result.second, result.first);
+    }
 
-    for (auto& [name, entry] : measurements_) {
-        results.emplace(entry.elapsed / entry.count, name);
+    if (frames_.count > 0) {
+        row(frames_.stats(), "frame");
     }
 
-    std::cout << "Brief stats per frame:" << std::endl;
-    for (auto& [elapsed, name] : results) {
-        std::cout << std::fixed << std::setw(13) << elapsed * 1000.0 << " ms :\t" << std::string(name) << std::endl;
+    if (dropped > 0) {
+        std::cout << "Dropped records: " << dropped << std::endl;
     }
 }
 
-AutomaticProfiler::AutomaticProfiler(cstr name)
-    : name_(name)
+AutomaticProfiler::AutomaticProfiler(AutomaticProfilerScope scope)
+    : scope_(scope)
+    , depth_(thread_depth_++)
 {
-    begin_ = std::chrono::high_resolution_clock::now();
+    begin_ = std::chrono::steady_clock::now();
 }
 
 AutomaticProfiler::~AutomaticProfiler()
 {
-    end_ = std::chrono::high_resolution_clock::now();
+    end_ = std::chrono::steady_clock::now();
+    --thread_depth_;
 
-    AutomaticProfilerRegister::get()->add(name_, begin_, end_);
+    AutomaticProfilerRegister::get()->add(scope_.name, scope_.id, begin_, end_, depth_);
 }
 
 
@@ -1,45 +1,283 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <source_location>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "defines.hpp"
+#include "names.hpp"
 
 namespace engine {
 
-using time_t    = std::chrono::time_point<std::chrono::high_resolution_clock>;
+// steady: a wall clock stepping back would produce negative durations
+using time_t    = std::chrono::time_point<std::chrono::steady_clock>;
 using elapsed_t = f64;
 
+/*
+ * Log-linear histogram of durations in nanoseconds: values below 2 * sub_count are exact,
+ * larger ones fall into sub_count buckets per power of two (about 3% relative error)
+ */
+class AutomaticProfilerHistogram {
+public:
+    static constexpr size_t sub_bits  = 5;
+    static constexpr size_t sub_count = 1 << sub_bits;
+    static constexpr size_t buckets   = (64 - sub_bits) * sub_count;
+
+    void add(u64 ns) noexcept;
+
+    /*
+     * Upper bound of the bucket holding the given quantile, in nanoseconds
+     */
+    u64 quantile(f64 q) const noexcept;
+
+    size_t count() const noexcept;
+
+private:
+    static size_t index(u64 ns) noexcept;
+
+    static u64 upper(size_t index) noexcept;
+
+    std::array<u32, buckets> counts_{};
+    size_t count_{0};
+};
+
+struct AutomaticProfilerStats {
+    size_t count{0};
+    elapsed_t mean{0.0};
+    elapsed_t min{0.0};
+    elapsed_t max{0.0};
+    elapsed_t p50{0.0};
+    elapsed_t p95{0.0};
+    elapsed_t p99{0.0};
+    elapsed_t p999{0.0};
+    size_t over_budget{0};
+};
+
+/*
+ * Rolling view over the last window_frames frames, published by the collector
+ */
+struct AutomaticProfilerSnapshot {
+    std::vector<elapsed_t> frames;
+    std::vector<std::pair<cstr, elapsed_t>> scopes;
+};
+
 struct AutomaticProfilerEntry {
-    elapsed_t elapsed;
-    size_t count;
+    cstr name{""};
+    elapsed_t elapsed{0.0};
+    size_t count{0};
+    elapsed_t min{0.0};
+    elapsed_t max{0.0};
+    size_t over_budget{0};
+    AutomaticProfilerHistogram histogram;
+
+    void add(elapsed_t sample, elapsed_t budget) noexcept;
+
+    AutomaticProfilerStats stats() const noexcept;
+};
+
+/*
+ * Finished scope or frame marker, depth is the number of enclosing scopes on the same thread
+ */
+struct AutomaticProfilerRecord {
+    cstr name;
+    StringId id;
+    time_t begin;
+    time_t end;
+    u32 depth;
+    bool frame;
 };
 
+struct AutomaticProfilerTraceEvent {
+    AutomaticProfilerRecord record;
+    size_t thread;
+};
+
+/*
+ * Single producer, single consumer ring of records: the owning thread appends,
+ * the collector drains. Records that do not fit are dropped and counted.
+ */
+class AutomaticProfilerBuffer {
+public:
+    static constexpr size_t capacity = 1 << 14;
+
+    void push(const AutomaticProfilerRecord& record) noexcept
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+
+        if (head - tail_.load(std::memory_order_acquire) == capacity) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        records_[head & (capacity - 1)] = record;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    template <typename Consumer>
+    void drain(Consumer&& consumer) noexcept
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+
+        for (; tail != head; ++tail) {
+            consumer(records_[tail & (capacity - 1)]);
+        }
+
+        tail_.store(tail, std::memory_order_release);
+    }
+
+    size_t dropped() const noexcept
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::array<AutomaticProfilerRecord, capacity> records_;
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<size_t> dropped_{0};
+};
+
+/*
+ * Every thread writes into its own buffer without locking, a collector thread
+ * periodically drains all buffers and aggregates measurements
+ */
 class AutomaticProfilerRegister {
 public:
-    void add(cstr name, time_t begin, time_t end);
+    static constexpr size_t trace_capacity = 1 << 20;
+    static constexpr size_t window_frames  = 240;
+
+    void add(cstr name, StringId id, time_t begin, time_t end, u32 depth);
+
+    /*
+     * Marks the beginning of a new frame on the timeline
+     */
+    void frame();
+
+    /*
+     * Drains all thread buffers into measurements_ and the timeline
+     */
+    void collect();
+
+    /*
+     * Samples longer than budget are counted as violations, one frame at 60 FPS by default
+     */
+    void budget(elapsed_t seconds);
+
+    elapsed_t budget() const noexcept;
+
+    /*
+     * Aggregated stats of a scope, empty stats if it was never sampled
+     */
+    AutomaticProfilerStats stats(cstr name);
+
+    /*
+     * Aggregated stats of every sampled scope
+     */
+    std::vector<std::pair<cstr, AutomaticProfilerStats>> stats();
+
+    /*
+     * Aggregated frame times measured between frame markers
+     */
+    AutomaticProfilerStats frames();
+
+    /*
+     * Copies the last published window: frame times oldest first and mean time per
+     * frame of every scope, most expensive first. Does not wait for collection.
+     */
+    void snapshot(AutomaticProfilerSnapshot& snapshot);
+
+    /*
+     * Drops everything aggregated so far, the trace timeline is kept
+     */
+    void reset();
+
+    /*
+     * Records lost so far because a thread buffer was full
+     */
+    size_t dropped();
+
+    /*
+     * Writes the last trace_capacity timeline events as Chrome Trace Event JSON,
+     * viewable in chrome://tracing or Perfetto. Also done on shutdown when
+     * PROFILE_TRACE environment variable names the output file.
+     */
+    bool trace(cstr path);
 
     static rptr<AutomaticProfilerRegister> get();
 
     ~AutomaticProfilerRegister();
-    AutomaticProfilerRegister() = default;
+    AutomaticProfilerRegister();
 
-    std::unordered_map<cstr, AutomaticProfilerEntry> measurements_;
+    /*
+     * Scopes are keyed by hashed name, the same literal may live at different addresses
+     */
+    std::unordered_map<StringId, AutomaticProfilerEntry> measurements_;
 
     static uptr<AutomaticProfilerRegister> instance_;
+
+private:
+    struct Window {
+        elapsed_t frame;
+        std::unordered_map<StringId, elapsed_t> scopes;
+    };
+
+    rptr<AutomaticProfilerBuffer> local();
+
+    void publish();
+
+    time_t epoch_;
+    std::atomic<elapsed_t> budget_{1.0 / 60.0};
+    AutomaticProfilerEntry frames_;
+    std::vector<time_t> last_frame_;
+    std::deque<AutomaticProfilerTraceEvent> timeline_;
+    std::deque<Window> window_;
+    std::unordered_map<StringId, elapsed_t> window_current_;
+    std::unordered_map<StringId, elapsed_t> window_totals_;
+    AutomaticProfilerSnapshot snapshot_;
+    std::mutex snapshot_mutex_;
+    std::vector<uptr<AutomaticProfilerBuffer>> buffers_;
+    std::mutex buffers_mutex_;
+    std::mutex collect_mutex_;
+
+    std::thread collector_;
+    std::mutex collector_mutex_;
+    std::condition_variable collector_cv_;
+    bool stop_{false};
+};
+
+/*
+ * Name of a profiled scope, hashed at compile time
+ */
+struct AutomaticProfilerScope {
+    consteval AutomaticProfilerScope(cstr name)
+        : name(name)
+        , id(name)
+    {
+    }
+
+    cstr name;
+    StringId id;
 };
 
 class AutomaticProfiler {
 public:
-    AutomaticProfiler(cstr name);
+    AutomaticProfiler(AutomaticProfilerScope scope);
 
     ~AutomaticProfiler();
 
 private:
     time_t begin_;
     time_t end_;
-    cstr name_;
+    AutomaticProfilerScope scope_;
+    u32 depth_;
 };
 
 #define GET_NAME() __FILE__##__FUNCTION__##__LINE__
@@ -47,9 +285,11 @@ private:
 #if PROFILING == 1
 #define PROFILE(name) engine::AutomaticProfiler GET_NAME()(#name)
 #define PROFILE_FUNCTION() engine::AutomaticProfiler GET_NAME()(std::source_location::current().function_name())
+#define PROFILE_FRAME() engine::AutomaticProfilerRegister::get()->frame()
 #else
 #define PROFILE(name)
 #define PROFILE_FUNCTION()
+#define PROFILE_FRAME()
 #endif
 
 } // namespace engine
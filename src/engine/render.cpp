@@ -0,0 +1,73 @@
+#include "render.hpp"
+
+#include <algorithm>
+
+#include "profiling.hpp"
+
+namespace engine {
+
+void RenderQueue::push(const DrawCommand& command) noexcept
+{
+    // flipping the sign bit makes negative layers sort before positive ones
+    u64 layer = static_cast<u32>(command.layer) ^ 0x80000000u;
+
+    u64 order = layer << 32 | command.texture.id;
+
+    // runs of the same texture are common, try the bucket used last before searching
+    if (last_ >= buckets_.size() || buckets_[last_].order != order) {
+        auto bucket = std::lower_bound(
+            buckets_.begin(), buckets_.end(), order, [](const Bucket& b, u64 o) { return b.order < o; });
+
+        if (bucket == buckets_.end() || bucket->order != order) {
+            bucket = buckets_.insert(bucket, Bucket{.order = order, .commands = {}});
+        }
+
+        last_ = static_cast<size_t>(bucket - buckets_.begin());
+    }
+
+    buckets_[last_].commands.push_back(static_cast<u32>(commands_.size()));
+    commands_.push_back(command);
+}
+
+void RenderQueue::clear() noexcept
+{
+    commands_.clear();
+
+    for (Bucket& bucket : buckets_) {
+        bucket.commands.clear();
+    }
+}
+
+void RenderQueue::submit() noexcept
+{
+    PROFILE_FUNCTION();
+
+    batches_ = 0;
+    u32 last = 0;
+
+    for (const Bucket& bucket : buckets_) {
+        for (u32 index : bucket.commands) {
+            const DrawCommand& command = commands_[index];
+
+            if (batches_ == 0 || command.texture.id != last) {
+                last = command.texture.id;
+                ++batches_;
+            }
+
+            DrawTexturePro(
+                command.texture, command.source, command.dest, command.origin, command.rotation, command.tint);
+        }
+    }
+}
+
+size_t RenderQueue::size() const noexcept
+{
+    return commands_.size();
+}
+
+size_t RenderQueue::batches() const noexcept
+{
+    return batches_;
+}
+
+} // namespace engine
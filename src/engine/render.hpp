@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include "defines.hpp"
+
+namespace engine {
+
+struct DrawCommand {
+    i32 layer{0};
+    Texture2D texture{};
+    Rectangle source{};
+    Rectangle dest{};
+    Vector2 origin{};
+    f32 rotation{0.0f};
+    Color tint{};
+};
+
+/*
+ * Collects sprites of a pass and draws them sorted by layer then texture, so every texture
+ * of a layer ends up in one contiguous batch. Submission order is kept within a batch.
+ * Commands are filed into their batch as they are pushed, submit never sorts.
+ */
+class RenderQueue {
+public:
+    void push(const DrawCommand& command) noexcept;
+
+    void clear() noexcept;
+
+    void submit() noexcept;
+
+    size_t size() const noexcept;
+
+    /*
+     * Texture switches during the last submit
+     */
+    size_t batches() const noexcept;
+
+private:
+    /*
+     * Commands of one layer and texture in push order. Buckets outlive clear(), so their
+     * storage is reused by the next pass; empty ones are skipped.
+     */
+    struct Bucket {
+        u64 order{0};
+        std::vector<u32> commands;
+    };
+
+    std::vector<DrawCommand> commands_;
+    std::vector<Bucket> buckets_;
+    size_t last_{0};
+    size_t batches_{0};
+};
+
+} // namespace engine
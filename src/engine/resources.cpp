@@ -1,15 +1,49 @@
 #include "resources.hpp"
 
+#include <fstream>
+#include <iterator>
+
 namespace engine {
 Filesystem::Filesystem(string root) noexcept
 {
     root_ = std::move(root);
 }
 
-string Filesystem::resolve(string relative) noexcept
+Filesystem::Filesystem(string root, string archive) noexcept
+    : Filesystem(std::move(root))
+{
+    archive_ = Archive::open(resolve(std::move(archive)));
+}
+
+string Filesystem::resolve(string relative) const noexcept
 {
     std::filesystem::path absilut = root_ / relative;
     return absilut.string();
 }
 
+Blob Filesystem::read(const string& relative) const noexcept
+{
+    Blob blob;
+    if (archive_ && archive_->read(relative, blob)) {
+        return blob;
+    }
+
+    return read_loose(relative);
+}
+
+Blob Filesystem::read_loose(const string& relative) const noexcept
+{
+    std::ifstream file(resolve(relative), std::ios::binary);
+    if (!file) {
+        return Blob();
+    }
+
+    return Blob(std::vector<byte>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+}
+
+bool Filesystem::packed() const noexcept
+{
+    return archive_ != nullptr;
+}
+
 } // namespace engine
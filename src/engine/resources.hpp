@@ -1,64 +1,426 @@
 #pragma once
 
+#include <chrono>
 #include <filesystem>
+#include <limits>
+#include <thread>
 #include <unordered_map>
 
+#include "archive.hpp"
+#include "assets.hpp"
+#include "atlas.hpp"
+#include "core.hpp"
 #include "defines.hpp"
+#include "loader.hpp"
+#include "mixer.hpp"
+#include "watcher.hpp"
 
 namespace engine {
 
 using Texture = Texture2D;
 using Music   = Music;
 
+/*
+ * Files relative to the root. With an archive name files are served from that archive under
+ * the root once it maps, files missing from it and everything else come from loose files.
+ * Copies share the mapping and are safe to read from on any thread.
+ */
 class Filesystem {
 public:
     Filesystem(string root) noexcept;
 
-    string resolve(string relative) noexcept;
+    Filesystem(string root, string archive) noexcept;
+
+    string resolve(string relative) const noexcept;
+
+    /*
+     * Contents of the file, empty when it can not be read
+     */
+    Blob read(const string& relative) const noexcept;
+
+    /*
+     * Contents of the file under the root, skipping the archive
+     */
+    Blob read_loose(const string& relative) const noexcept;
+
+    bool packed() const noexcept;
 
 private:
     std::filesystem::path root_;
+    sptr<const Archive> archive_;
 };
 
+/*
+ * Textures by alias. With a non-zero atlas side images are packed into shared atlas pages
+ * of that size instead of getting a texture each, so sprites using them batch together.
+ * Space of unloaded regions is not reused until the holder is destroyed.
+ *
+ * Code that keeps a texture, like a sprite drawing it, acquires a handle, looks the texture up
+ * through it whenever it is used and releases it when done. Textures without handles are evicted,
+ * least recently used first, once the resident bytes go over budget, and loaded back when asked
+ * for again. Atlas regions live on shared pages and are never evicted, so with an atlas the budget
+ * frees nothing.
+ *
+ * load_async reads and decodes the image on a loader thread, the upload happens in upload()
+ * on the main thread. Until then get() returns an empty region.
+ *
+ * After watch() files of loaded textures are reloaded when they change on disk and swapped in
+ * by upload(). Images that kept their size are written over the old pixels, resized ones get
+ * a new region; code looking textures up by handle picks up both. Every reload bumps the
+ * revision of the texture, so whatever baked it somewhere else knows to do it again.
+ */
 template <typename Alias>
 class TextureHolder {
 public:
-    TextureHolder(Filesystem& fs)
+    TextureHolder(Filesystem& fs, i32 atlas = 0)
         : fs_(fs)
     {
+        if (atlas > 0) {
+            atlas_ = std::make_unique<Atlas>(atlas);
+        }
+    }
+
+    TextureHolder(const TextureHolder&)            = delete;
+    TextureHolder& operator=(const TextureHolder&) = delete;
+
+    /*
+     * Loads the texture unless the alias is already taken
+     */
+    const Region& load(string name, const Alias& alias) noexcept
+    {
+        Slot& slot = table_.insert(alias, name);
+
+        if (!slot.resident && !slot.handle.pending()) {
+            fetch(slot);
+            follow(slot);
+            evict();
+        }
+
+        return slot.asset;
     }
 
-    Texture& load(string name, Alias alias) noexcept
+    LoadHandle load_async(string name, const Alias& alias) noexcept
     {
-        Texture res = LoadTexture(fs_.resolve(name).c_str());
-        textures_.emplace(alias, res);
+        Slot& slot = table_.insert(alias, name);
+
+        if (slot.resident || slot.handle.pending()) {
+            return slot.handle;
+        }
 
-        return get(alias);
+        if (Platform::get()->headless()) {
+            place(slot, Region{});
+            return slot.handle;
+        }
+
+        slot.handle = LoadHandle::create();
+
+        Loader::get()->submit([inbox = inbox_, fs = fs_, name, id = table_.id(slot)]() {
+            inbox->push(Decoded{.id = id, .image = decode(name, fs.read(name)), .reload = false});
+        });
+
+        follow(slot);
+
+        return slot.handle;
     }
 
-    Texture& get(Alias alias) noexcept
+    /*
+     * Uploads decoded images until budget seconds are spent, at least one per call
+     */
+    void upload(f64 budget) noexcept
     {
-        return textures_[alias];
+        auto begin = std::chrono::steady_clock::now();
+
+        Decoded decoded;
+        while (inbox_->pop(decoded)) {
+            // the texture may have been unloaded while it was decoding
+            if (rptr<Slot> slot = table_.find(decoded.id)) {
+                if (decoded.reload) {
+                    replace(*slot, decoded.image);
+                }
+                else {
+                    place(*slot, add(decoded.image));
+                }
+            }
+
+            decoded.release();
+
+            if (std::chrono::duration<f64>(std::chrono::steady_clock::now() - begin).count() >= budget) {
+                break;
+            }
+        }
+
+        evict();
     }
 
-    void unload(Alias alias) noexcept
+    /*
+     * Uploads on the calling thread until the load is done, has to be the main thread
+     */
+    void wait(const LoadHandle& handle) noexcept
     {
-        UnloadTexture(textures_[alias]);
-        textures_.erase(alias);
+        while (handle.pending()) {
+            upload(std::numeric_limits<f64>::infinity());
+            std::this_thread::yield();
+        }
     }
 
-    ~TextureHolder()
+    /*
+     * Handle of a loaded alias, counted as in use until released
+     */
+    AssetId acquire(const Alias& alias) noexcept
+    {
+        rptr<Slot> slot = table_.find(alias);
+        if (!slot) {
+            return AssetTable<Alias, Region>::invalid;
+        }
+
+        table_.acquire(*slot);
+        return table_.id(*slot);
+    }
+
+    /*
+     * Releasing a stale handle is a no-op
+     */
+    void release(AssetId id) noexcept
+    {
+        rptr<Slot> slot = table_.find(id);
+        if (slot && table_.release(*slot)) {
+            evict();
+        }
+    }
+
+    /*
+     * Texture of the handle, loaded back when it was evicted, empty for stale handles
+     */
+    const Region& get(AssetId id) noexcept
+    {
+        rptr<Slot> slot = table_.find(id);
+        return slot ? resident(*slot) : empty_;
+    }
+
+    /*
+     * Texture of the alias, loaded back when it was evicted, empty for unknown aliases
+     */
+    const Region& get(const Alias& alias) noexcept
+    {
+        rptr<Slot> slot = table_.find(alias);
+        return slot ? resident(*slot) : empty_;
+    }
+
+    /*
+     * Number of reloads swapped in for the handle, 0 for stale handles
+     */
+    u32 revision(AssetId id) noexcept
+    {
+        rptr<Slot> slot = table_.find(id);
+        return slot ? slot->revision : 0;
+    }
+
+    void unload(const Alias& alias) noexcept
+    {
+        if (rptr<Slot> slot = table_.find(alias)) {
+            free(*slot);
+            table_.erase(*slot);
+        }
+    }
+
+    /*
+     * Bytes of resident textures allowed before unused ones are evicted
+     */
+    void budget(size_t bytes) noexcept
+    {
+        table_.budget(bytes);
+        evict();
+    }
+
+    /*
+     * Estimated bytes of resident textures, atlas pages excluded
+     */
+    size_t memory() const noexcept
+    {
+        return table_.memory();
+    }
+
+    /*
+     * Distinct textures the loaded regions live on
+     */
+    size_t textures() const noexcept
+    {
+        if (atlas_) {
+            return atlas_->textures();
+        }
+
+        size_t count = 0;
+        table_.each([&count](const Slot& slot) { count += slot.asset.texture.id != 0; });
+
+        return count;
+    }
+
+    /*
+     * Reloads textures loaded from now on when their files change, does nothing when headless
+     */
+    void watch() noexcept
     {
-        for (auto& [alias, texture] : textures_) {
-            UnloadTexture(texture);
+        if (!Platform::get()->headless() && !watcher_) {
+            watcher_ = std::make_unique<Watcher>();
         }
     }
 
+    ~TextureHolder()
+    {
+        table_.each([this](Slot& slot) { free(slot); });
+    }
+
 private:
-    std::unordered_map<Alias, Texture> textures_;
+    using Slot = typename AssetTable<Alias, Region>::Slot;
+
+    struct Decoded {
+        AssetId id{};
+        Image image{};
+        bool reload{false};
+
+        void release() noexcept
+        {
+            UnloadImage(image);
+        }
+    };
+
+    static Image decode(const string& name, const Blob& blob) noexcept
+    {
+        if (blob.empty()) {
+            return Image{};
+        }
+
+        return LoadImageFromMemory(GetFileExtension(name.c_str()), blob.data(), static_cast<i32>(blob.size()));
+    }
+
+    Region add(Image image) noexcept
+    {
+        if (atlas_) {
+            return atlas_->add(image);
+        }
+
+        if (image.data == nullptr) {
+            return Region{};
+        }
+
+        Texture texture = LoadTextureFromImage(image);
+        return Region{.texture = texture, .rect = Rectangle{0.0f, 0.0f, f32(texture.width), f32(texture.height)}};
+    }
+
+    /*
+     * Loads the slot on the calling thread
+     */
+    void fetch(Slot& slot) noexcept
+    {
+        Region res{};
+
+        // no graphics context to upload into when headless
+        if (!Platform::get()->headless()) {
+            Image image = decode(slot.name, fs_.read(slot.name));
+            res         = add(image);
+            UnloadImage(image);
+        }
+
+        place(slot, res);
+    }
+
+    void place(Slot& slot, Region region) noexcept
+    {
+        free(slot);
+
+        slot.asset = region;
+
+        // atlas pages are shared, evicting a region would not free anything
+        table_.resident(slot, atlas_ ? 0 : size_t(region.texture.width) * size_t(region.texture.height) * 4);
+
+        if (!slot.handle.ready() && !slot.handle.failed()) {
+            slot.handle.resolve(region.texture.id != 0);
+        }
+        else {
+            slot.handle = LoadHandle::create(region.texture.id != 0 ? LoadState::ready : LoadState::failed);
+        }
+    }
+
+    const Region& resident(Slot& slot) noexcept
+    {
+        table_.touch(slot);
+
+        if (!slot.resident && !slot.handle.pending()) {
+            fetch(slot);
+            evict();
+        }
+
+        return slot.asset;
+    }
+
+    void free(Slot& slot) noexcept
+    {
+        if (!atlas_ && slot.resident && slot.asset.texture.id != 0) {
+            UnloadTexture(slot.asset.texture);
+        }
+    }
+
+    void evict() noexcept
+    {
+        table_.evict([this](Slot& slot) { free(slot); });
+    }
+
+    void follow(const Slot& slot) noexcept
+    {
+        if (!watcher_) {
+            return;
+        }
+
+        // edits land in loose files, an archive keeps serving the packed version
+        watcher_->watch(fs_.resolve(slot.name), [inbox = inbox_, fs = fs_, name = slot.name, id = table_.id(slot)]() {
+            Loader::get()->submit([inbox, fs, name, id]() {
+                inbox->push(Decoded{.id = id, .image = decode(name, fs.read_loose(name)), .reload = true});
+            });
+        });
+    }
+
+    void replace(Slot& slot, Image& image) noexcept
+    {
+        // evicted textures are loaded fresh anyway, the file may also be caught halfway through a write
+        if (!slot.resident || image.data == nullptr) {
+            return;
+        }
+
+        Region& region = slot.asset;
+        bool same      = image.width == i32(region.rect.width) && image.height == i32(region.rect.height);
+
+        ++slot.revision;
+
+        if (region.texture.id != 0 && same) {
+            ImageFormat(&image, region.texture.format);
+            UpdateTextureRec(region.texture, region.rect, image.data);
+            return;
+        }
+
+        place(slot, add(image));
+    }
+
+    AssetTable<Alias, Region> table_;
+    uptr<Atlas> atlas_;
+    sptr<Inbox<Decoded>> inbox_{std::make_shared<Inbox<Decoded>>()};
+    uptr<Watcher> watcher_;
+    Region empty_{};
     Filesystem& fs_;
 };
 
+/*
+ * Music streams by alias, opened from the bytes of the file, which are kept until the stream
+ * is unloaded.
+ *
+ * Like textures, streams are kept in use by acquired handles. Unused ones are evicted when
+ * the bytes of their files go over budget and opened again when asked for.
+ *
+ * load_async reads the file on a loader thread and opens the stream in upload() on the main
+ * thread. After watch() files of loaded music are reloaded when they change on disk, upload()
+ * replaces the stream behind the handle and players post the new one to the mixer.
+ *
+ * Playback itself belongs to the Mixer, streams are stopped there before they are unloaded.
+ */
 template <typename Alias>
 class AudioHolder {
 public:
@@ -67,34 +429,291 @@ public:
     {
     }
 
-    Music& load(string name, Alias alias) noexcept
+    AudioHolder(const AudioHolder&)            = delete;
+    AudioHolder& operator=(const AudioHolder&) = delete;
+
+    /*
+     * Opens the stream unless the alias is already taken
+     */
+    const Music& load(string name, const Alias& alias) noexcept
     {
-        Music res = LoadMusicStream(fs_.resolve(name).c_str());
-        music_.emplace(alias, res);
+        Slot& slot = table_.insert(alias, name);
+
+        if (!slot.resident && !slot.handle.pending()) {
+            fetch(slot);
+            follow(slot);
+            evict();
+        }
 
-        return get(alias);
+        return slot.asset.music;
     }
 
-    Music& get(Alias alias) noexcept
+    LoadHandle load_async(string name, const Alias& alias) noexcept
     {
-        return music_[alias];
+        Slot& slot = table_.insert(alias, name);
+
+        if (slot.resident || slot.handle.pending()) {
+            return slot.handle;
+        }
+
+        if (Platform::get()->headless()) {
+            place(slot, Stream{});
+            return slot.handle;
+        }
+
+        slot.handle = LoadHandle::create();
+
+        Loader::get()->submit([inbox = inbox_, fs = fs_, name, id = table_.id(slot)]() {
+            inbox->push(Decoded{.id = id, .name = name, .blob = fs.read(name), .reload = false});
+        });
+
+        follow(slot);
+
+        return slot.handle;
     }
 
-    void unload(Alias alias) noexcept
+    /*
+     * Opens streams of read files until budget seconds are spent, at least one per call
+     */
+    void upload(f64 budget) noexcept
     {
-        UnloadMusicStream(music_[alias]);
-        music_.erase(alias);
+        auto begin = std::chrono::steady_clock::now();
+
+        Decoded decoded;
+        while (inbox_->pop(decoded)) {
+            if (rptr<Slot> slot = table_.find(decoded.id)) {
+                if (decoded.reload) {
+                    replace(*slot, std::move(decoded.blob));
+                }
+                else {
+                    place(*slot, open(decoded.name, std::move(decoded.blob)));
+                }
+            }
+
+            decoded.release();
+
+            if (std::chrono::duration<f64>(std::chrono::steady_clock::now() - begin).count() >= budget) {
+                break;
+            }
+        }
+
+        evict();
     }
 
-    ~AudioHolder()
+    /*
+     * Opens streams on the calling thread until the load is done, has to be the main thread
+     */
+    void wait(const LoadHandle& handle) noexcept
     {
-        for (auto& [alias, music] : music_) {
-            UnloadMusicStream(music);
+        while (handle.pending()) {
+            upload(std::numeric_limits<f64>::infinity());
+            std::this_thread::yield();
         }
     }
 
+    /*
+     * Handle of a loaded alias, counted as in use until released
+     */
+    AssetId acquire(const Alias& alias) noexcept
+    {
+        rptr<Slot> slot = table_.find(alias);
+        if (!slot) {
+            return AssetTable<Alias, Stream>::invalid;
+        }
+
+        table_.acquire(*slot);
+        return table_.id(*slot);
+    }
+
+    /*
+     * Releasing a stale handle is a no-op
+     */
+    void release(AssetId id) noexcept
+    {
+        rptr<Slot> slot = table_.find(id);
+        if (slot && table_.release(*slot)) {
+            evict();
+        }
+    }
+
+    /*
+     * Stream of the handle, opened again when it was evicted, empty for stale handles
+     */
+    const Music& get(AssetId id) noexcept
+    {
+        rptr<Slot> slot = table_.find(id);
+        return slot ? resident(*slot) : empty_;
+    }
+
+    /*
+     * Stream of the alias, opened again when it was evicted, empty for unknown aliases
+     */
+    const Music& get(const Alias& alias) noexcept
+    {
+        rptr<Slot> slot = table_.find(alias);
+        return slot ? resident(*slot) : empty_;
+    }
+
+    void unload(const Alias& alias) noexcept
+    {
+        if (rptr<Slot> slot = table_.find(alias)) {
+            free(*slot);
+            table_.erase(*slot);
+        }
+    }
+
+    /*
+     * Bytes of files behind open streams allowed before unused ones are evicted
+     */
+    void budget(size_t bytes) noexcept
+    {
+        table_.budget(bytes);
+        evict();
+    }
+
+    size_t memory() const noexcept
+    {
+        return table_.memory();
+    }
+
+    /*
+     * Reloads music loaded from now on when its files change, does nothing when headless
+     */
+    void watch() noexcept
+    {
+        if (!Platform::get()->headless() && !watcher_) {
+            watcher_ = std::make_unique<Watcher>();
+        }
+    }
+
+    ~AudioHolder()
+    {
+        table_.each([this](Slot& slot) { free(slot); });
+    }
+
 private:
-    std::unordered_map<Alias, Music> music_;
+    /*
+     * Streams decode from the bytes as they play, so the blob lives next to the stream
+     */
+    struct Stream {
+        Music music{};
+        Blob blob;
+    };
+
+    using Slot = typename AssetTable<Alias, Stream>::Slot;
+
+    struct Decoded {
+        AssetId id{};
+        string name;
+        Blob blob;
+        bool reload{false};
+
+        void release() noexcept
+        {
+            blob = Blob();
+        }
+    };
+
+    static Stream open(const string& name, Blob blob) noexcept
+    {
+        if (blob.empty()) {
+            return Stream{};
+        }
+
+        Music music =
+            LoadMusicStreamFromMemory(GetFileExtension(name.c_str()), blob.data(), static_cast<i32>(blob.size()));
+
+        if (music.ctxData == nullptr) {
+            return Stream{};
+        }
+
+        return Stream{.music = music, .blob = std::move(blob)};
+    }
+
+    /*
+     * Opens the slot on the calling thread
+     */
+    void fetch(Slot& slot) noexcept
+    {
+        place(slot, Platform::get()->headless() ? Stream{} : open(slot.name, fs_.read(slot.name)));
+    }
+
+    void place(Slot& slot, Stream stream) noexcept
+    {
+        free(slot);
+
+        bool ok    = stream.music.ctxData != nullptr;
+        size_t len = stream.blob.size();
+        slot.asset = std::move(stream);
+        table_.resident(slot, len);
+
+        if (!slot.handle.ready() && !slot.handle.failed()) {
+            slot.handle.resolve(ok);
+        }
+        else {
+            slot.handle = LoadHandle::create(ok ? LoadState::ready : LoadState::failed);
+        }
+    }
+
+    const Music& resident(Slot& slot) noexcept
+    {
+        table_.touch(slot);
+
+        if (!slot.resident && !slot.handle.pending()) {
+            fetch(slot);
+            evict();
+        }
+
+        return slot.asset.music;
+    }
+
+    void free(Slot& slot) noexcept
+    {
+        if (slot.resident && slot.asset.music.ctxData != nullptr) {
+            // the mixer may be refilling the stream right now
+            Mixer::get()->stop(slot.asset.music);
+            Mixer::get()->sync();
+            UnloadMusicStream(slot.asset.music);
+        }
+    }
+
+    void evict() noexcept
+    {
+        table_.evict([this](Slot& slot) { free(slot); });
+    }
+
+    void follow(const Slot& slot) noexcept
+    {
+        if (!watcher_) {
+            return;
+        }
+
+        watcher_->watch(fs_.resolve(slot.name), [inbox = inbox_, fs = fs_, name = slot.name, id = table_.id(slot)]() {
+            Loader::get()->submit([inbox, fs, name, id]() {
+                inbox->push(Decoded{.id = id, .name = name, .blob = fs.read_loose(name), .reload = true});
+            });
+        });
+    }
+
+    void replace(Slot& slot, Blob blob) noexcept
+    {
+        if (!slot.resident) {
+            return;
+        }
+
+        Stream stream = open(slot.name, std::move(blob));
+        if (stream.music.ctxData == nullptr) {
+            return;
+        }
+
+        // players see a new stream behind the handle and post it to the mixer again
+        place(slot, std::move(stream));
+    }
+
+    AssetTable<Alias, Stream> table_;
+    sptr<Inbox<Decoded>> inbox_{std::make_shared<Inbox<Decoded>>()};
+    uptr<Watcher> watcher_;
+    Music empty_{};
     Filesystem& fs_;
 };
 
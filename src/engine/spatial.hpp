@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include "defines.hpp"
+#include "ecs.hpp"
+
+namespace engine {
+
+/*
+ * Uniform grid over world-space bounds. Every entity is listed in each cell its bounds touch
+ * and carries a payload, so queries need no lookups back into the storage.
+ * Entries are updated in place when bounds stay within the same cells.
+ */
+template <typename Payload>
+class SpatialGrid {
+public:
+    SpatialGrid(f32 cell) noexcept
+        : cell_(cell)
+    {
+    }
+
+    /*
+     * Inserts or updates the entity
+     */
+    void insert(ecs::EntityId id, Rectangle bounds, const Payload& payload) noexcept
+    {
+        if (id.index >= entries_.size()) {
+            entries_.resize(id.index + 1);
+        }
+
+        Entry& entry = entries_[id.index];
+        Range range  = cells(bounds);
+
+        if (entry.present && entry.range == range) {
+            entry.id      = id;
+            entry.bounds  = bounds;
+            entry.payload = payload;
+            return;
+        }
+
+        if (entry.present) {
+            unlink(id.index);
+        }
+        else {
+            ++size_;
+        }
+
+        entry.id      = id;
+        entry.bounds  = bounds;
+        entry.range   = range;
+        entry.payload = payload;
+        entry.present = true;
+
+        for (i32 y = range.y0; y <= range.y1; ++y) {
+            for (i32 x = range.x0; x <= range.x1; ++x) {
+                cells_[key(x, y)].push_back(id.index);
+            }
+        }
+    }
+
+    void erase(ecs::EntityId id) noexcept
+    {
+        if (!contains(id)) {
+            return;
+        }
+
+        unlink(id.index);
+        entries_[id.index].present = false;
+        --size_;
+    }
+
+    bool contains(ecs::EntityId id) const noexcept
+    {
+        return id.index < entries_.size() && entries_[id.index].present && entries_[id.index].id == id;
+    }
+
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    /*
+     * Calls visit(EntityId, const Payload&) once for every entity whose bounds intersect the area
+     */
+    template <typename Visitor>
+    void query(Rectangle area, Visitor&& visit) noexcept
+    {
+        Range range = cells(area);
+        ++stamp_;
+
+        for (i32 y = range.y0; y <= range.y1; ++y) {
+            for (i32 x = range.x0; x <= range.x1; ++x) {
+                auto it = cells_.find(key(x, y));
+                if (it == cells_.end()) {
+                    continue;
+                }
+
+                for (u32 index : it->second) {
+                    Entry& entry = entries_[index];
+
+                    // wide bounds are listed in several cells, report them once
+                    if (entry.stamp == stamp_ || !intersects(entry.bounds, area)) {
+                        continue;
+                    }
+
+                    entry.stamp = stamp_;
+                    visit(entry.id, entry.payload);
+                }
+            }
+        }
+    }
+
+private:
+    struct Range {
+        i32 x0;
+        i32 y0;
+        i32 x1;
+        i32 y1;
+
+        bool operator==(const Range&) const = default;
+    };
+
+    struct Entry {
+        ecs::EntityId id{};
+        Rectangle bounds{};
+        Range range{};
+        Payload payload{};
+        u32 stamp{0};
+        bool present{false};
+    };
+
+    static u64 key(i32 x, i32 y) noexcept
+    {
+        return u64(u32(x)) << 32 | u32(y);
+    }
+
+    static bool intersects(Rectangle a, Rectangle b) noexcept
+    {
+        return a.x <= b.x + b.width && b.x <= a.x + a.width && a.y <= b.y + b.height && b.y <= a.y + a.height;
+    }
+
+    Range cells(Rectangle bounds) const noexcept
+    {
+        return Range{
+            .x0 = static_cast<i32>(std::floor(bounds.x / cell_)),
+            .y0 = static_cast<i32>(std::floor(bounds.y / cell_)),
+            .x1 = static_cast<i32>(std::floor((bounds.x + bounds.width) / cell_)),
+            .y1 = static_cast<i32>(std::floor((bounds.y + bounds.height) / cell_))};
+    }
+
+    void unlink(u32 index) noexcept
+    {
+        const Range& range = entries_[index].range;
+
+        for (i32 y = range.y0; y <= range.y1; ++y) {
+            for (i32 x = range.x0; x <= range.x1; ++x) {
+                std::vector<u32>& cell = cells_[key(x, y)];
+
+                auto it = std::find(cell.begin(), cell.end(), index);
+                *it     = cell.back();
+                cell.pop_back();
+            }
+        }
+    }
+
+    f32 cell_{1.0f};
+    size_t size_{0};
+    u32 stamp_{0};
+    std::vector<Entry> entries_;
+    std::unordered_map<u64, std::vector<u32>> cells_;
+};
+
+} // namespace engine
@@ -0,0 +1,264 @@
+#include "tilemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "profiling.hpp"
+
+namespace engine {
+
+Tilemap::Tilemap(i32 tile_px, f32 tile_size, u32 width, u32 height, size_t cache) noexcept
+    : tile_px_(tile_px)
+    , tile_size_(tile_size)
+    , width_(width)
+    , height_(height)
+    , chunks_x_((width + chunk_size - 1) / chunk_size)
+    , chunks_y_((height + chunk_size - 1) / chunk_size)
+    , cache_(cache)
+    , chunks_(chunks_x_ * chunks_y_)
+{
+}
+
+Tilemap::~Tilemap()
+{
+    for (size_t index : cached_) {
+        UnloadRenderTexture(chunks_[index].texture);
+    }
+}
+
+void Tilemap::set(u32 x, u32 y, Tile tile) noexcept
+{
+    assert(x < width_ && y < height_);
+
+    Chunk& chunk = chunks_[(y / chunk_size) * chunks_x_ + x / chunk_size];
+
+    chunk.tiles[(y % chunk_size) * chunk_size + x % chunk_size] = tile;
+    chunk.dirty                                                 = true;
+}
+
+const Tile& Tilemap::get(u32 x, u32 y) const noexcept
+{
+    assert(x < width_ && y < height_);
+
+    const Chunk& chunk = chunks_[(y / chunk_size) * chunks_x_ + x / chunk_size];
+    return chunk.tiles[(y % chunk_size) * chunk_size + x % chunk_size];
+}
+
+u32 Tilemap::width() const noexcept
+{
+    return width_;
+}
+
+u32 Tilemap::height() const noexcept
+{
+    return height_;
+}
+
+void Tilemap::render(Vector2 origin, Rectangle area, const Region& tileset, u32 revision) noexcept
+{
+    PROFILE_FUNCTION();
+
+    ++frame_;
+
+    bool moved = tileset.texture.id != tileset_.texture.id || tileset.rect.x != tileset_.rect.x ||
+                 tileset.rect.y != tileset_.rect.y || tileset.rect.width != tileset_.rect.width ||
+                 tileset.rect.height != tileset_.rect.height;
+
+    if (moved || revision != revision_) {
+        for (Chunk& chunk : chunks_) {
+            chunk.dirty = true;
+        }
+
+        tileset_  = tileset;
+        revision_ = revision;
+    }
+
+    Range range;
+    if (!chunks(origin, area, range)) {
+        return;
+    }
+
+    for (u32 y = range.y0; y <= range.y1; ++y) {
+        for (u32 x = range.x0; x <= range.x1; ++x) {
+            size_t index = y * chunks_x_ + x;
+
+            chunks_[index].used = frame_;
+            if (chunks_[index].dirty) {
+                refresh(index);
+            }
+        }
+    }
+}
+
+void Tilemap::draw(Vector2 origin, Rectangle area) noexcept
+{
+    PROFILE_FUNCTION();
+
+    Range range;
+    if (!chunks(origin, area, range)) {
+        return;
+    }
+
+    f32 side = chunk_size * tile_size_;
+    f32 px   = chunk_size * tile_px_;
+
+    for (u32 y = range.y0; y <= range.y1; ++y) {
+        for (u32 x = range.x0; x <= range.x1; ++x) {
+            const Chunk& chunk = chunks_[y * chunks_x_ + x];
+
+            if (chunk.texture.id == 0) {
+                continue;
+            }
+
+            // render textures are stored upside down
+            DrawTexturePro(
+                chunk.texture.texture,
+                Rectangle{0.0f, 0.0f, px, -px},
+                Rectangle{origin.x + x * side, origin.y + y * side, side, side},
+                Vector2{0.0f, 0.0f},
+                0.0f,
+                Color{255, 255, 255, 255});
+        }
+    }
+}
+
+size_t Tilemap::memory() const noexcept
+{
+    size_t side = chunk_size * tile_px_;
+    return chunks_.capacity() * sizeof(Chunk) + cached_.size() * side * side * 4;
+}
+
+bool Tilemap::chunks(Vector2 origin, Rectangle area, Range& range) const noexcept
+{
+    if (chunks_.empty()) {
+        return false;
+    }
+
+    f32 side = chunk_size * tile_size_;
+    f32 x0   = std::floor((area.x - origin.x) / side);
+    f32 y0   = std::floor((area.y - origin.y) / side);
+    f32 x1   = std::floor((area.x + area.width - origin.x) / side);
+    f32 y1   = std::floor((area.y + area.height - origin.y) / side);
+
+    if (x1 < 0.0f || y1 < 0.0f || x0 >= chunks_x_ || y0 >= chunks_y_) {
+        return false;
+    }
+
+    range = Range{
+        .x0 = static_cast<u32>(std::max(x0, 0.0f)),
+        .y0 = static_cast<u32>(std::max(y0, 0.0f)),
+        .x1 = std::min(static_cast<u32>(x1), chunks_x_ - 1),
+        .y1 = std::min(static_cast<u32>(y1), chunks_y_ - 1)};
+
+    return true;
+}
+
+void Tilemap::refresh(size_t index) noexcept
+{
+    Chunk& chunk = chunks_[index];
+    i32 side     = chunk_size * tile_px_;
+
+    if (chunk.texture.id == 0) {
+        evict();
+        chunk.texture = LoadRenderTexture(side, side);
+        cached_.push_back(index);
+    }
+
+    i32 columns = std::max(1, static_cast<i32>(tileset_.rect.width) / tile_px_);
+
+    BeginTextureMode(chunk.texture);
+    ClearBackground(Color{0, 0, 0, 0});
+
+    for (u32 i = 0; i < chunk.tiles.size(); ++i) {
+        const Tile& tile = chunk.tiles[i];
+
+        if (tile.index == Tile::empty) {
+            continue;
+        }
+
+        f32 px = static_cast<f32>(tile_px_);
+        DrawTexturePro(
+            tileset_.texture,
+            Rectangle{
+                tileset_.rect.x + (tile.index % columns) * px, tileset_.rect.y + (tile.index / columns) * px, px, px},
+            Rectangle{(i % chunk_size) * px, (i / chunk_size) * px, px, px},
+            Vector2{0.0f, 0.0f},
+            0.0f,
+            tile.tint);
+    }
+
+    EndTextureMode();
+
+    chunk.dirty = false;
+}
+
+void Tilemap::evict() noexcept
+{
+    if (cached_.size() < cache_) {
+        return;
+    }
+
+    auto oldest = std::min_element(cached_.begin(), cached_.end(), [this](size_t a, size_t b) {
+        return chunks_[a].used < chunks_[b].used;
+    });
+
+    // everything cached is on screen, going over the limit beats re-rendering every frame
+    if (chunks_[*oldest].used == frame_) {
+        return;
+    }
+
+    Chunk& chunk = chunks_[*oldest];
+    UnloadRenderTexture(chunk.texture);
+    chunk.texture = RenderTexture2D{};
+    chunk.dirty   = true;
+
+    *oldest = cached_.back();
+    cached_.pop_back();
+}
+
+u32 TilemapTable::insert(uptr<Tilemap> map) noexcept
+{
+    if (free_.empty()) {
+        maps_.push_back(std::move(map));
+        return static_cast<u32>(maps_.size() - 1);
+    }
+
+    u32 index = free_.back();
+    free_.pop_back();
+
+    maps_[index] = std::move(map);
+    return index;
+}
+
+rptr<Tilemap> TilemapTable::get(u32 index) const noexcept
+{
+    return index < maps_.size() ? maps_[index].get() : nullptr;
+}
+
+void TilemapTable::erase(u32 index) noexcept
+{
+    if (index < maps_.size() && maps_[index]) {
+        maps_[index].reset();
+        free_.push_back(index);
+    }
+}
+
+size_t TilemapTable::size() const noexcept
+{
+    return maps_.size() - free_.size();
+}
+
+size_t TilemapTable::memory() const noexcept
+{
+    size_t bytes = maps_.capacity() * sizeof(uptr<Tilemap>) + free_.capacity() * sizeof(u32);
+
+    for (const uptr<Tilemap>& map : maps_) {
+        if (map) {
+            bytes += sizeof(Tilemap) + map->memory();
+        }
+    }
+
+    return bytes;
+}
+
+} // namespace engine
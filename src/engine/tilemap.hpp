@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "atlas.hpp"
+#include "defines.hpp"
+
+namespace engine {
+
+struct Tile {
+    static constexpr u16 empty = 0xFFFF;
+
+    u16 index{empty};
+    Color tint{255, 255, 255, 255};
+};
+
+/*
+ * Grid of tiles from a tileset texture, stored in square chunks. Every visible chunk is drawn
+ * from its own render texture, which is refreshed only after one of its tiles changed.
+ * At most cache chunk textures are kept, the least recently drawn ones are released first.
+ */
+class Tilemap {
+public:
+    static constexpr u32 chunk_size = 32;
+
+    /*
+     * tile_px is the side of a tile in the tileset and in chunk textures,
+     * tile_size is the side of a tile in the world
+     */
+    Tilemap(i32 tile_px, f32 tile_size, u32 width, u32 height, size_t cache = 256) noexcept;
+
+    Tilemap(const Tilemap&)            = delete;
+    Tilemap& operator=(const Tilemap&) = delete;
+
+    ~Tilemap();
+
+    void set(u32 x, u32 y, Tile tile) noexcept;
+
+    const Tile& get(u32 x, u32 y) const noexcept;
+
+    u32 width() const noexcept;
+
+    u32 height() const noexcept;
+
+    /*
+     * Re-renders dirty chunks intersecting the world area from the tileset, must be called outside
+     * of BeginMode2D since texture mode resets the camera transform. The tileset is passed every time
+     * so it can be looked up by handle, it may be a region of an atlas page. All chunks are rendered
+     * again once the tileset moved or its revision changed, like after a reload.
+     */
+    void render(Vector2 origin, Rectangle area, const Region& tileset, u32 revision = 0) noexcept;
+
+    /*
+     * Draws chunks intersecting the world area, rendered ones only
+     */
+    void draw(Vector2 origin, Rectangle area) noexcept;
+
+    /*
+     * Bytes occupied by tiles and cached chunk textures
+     */
+    size_t memory() const noexcept;
+
+private:
+    struct Chunk {
+        std::array<Tile, chunk_size * chunk_size> tiles;
+        RenderTexture2D texture{};
+        u64 used{0};
+        bool dirty{true};
+    };
+
+    struct Range {
+        u32 x0;
+        u32 y0;
+        u32 x1;
+        u32 y1;
+    };
+
+    bool chunks(Vector2 origin, Rectangle area, Range& range) const noexcept;
+
+    void refresh(size_t index) noexcept;
+
+    void evict() noexcept;
+
+    Region tileset_{};
+    u32 revision_{0};
+    i32 tile_px_{0};
+    f32 tile_size_{0.0f};
+    u32 width_{0};
+    u32 height_{0};
+    u32 chunks_x_{0};
+    u32 chunks_y_{0};
+    size_t cache_{0};
+    u64 frame_{0};
+    std::vector<Chunk> chunks_;
+    std::vector<size_t> cached_;
+};
+
+/*
+ * Owns tilemaps for components that must stay trivially copyable, they hold the index instead.
+ * Indices of erased tilemaps are reused, erase one only once nothing refers to it.
+ */
+class TilemapTable {
+public:
+    u32 insert(uptr<Tilemap> map) noexcept;
+
+    rptr<Tilemap> get(u32 index) const noexcept;
+
+    void erase(u32 index) noexcept;
+
+    size_t size() const noexcept;
+
+    size_t memory() const noexcept;
+
+private:
+    std::vector<uptr<Tilemap>> maps_;
+    std::vector<u32> free_;
+};
+
+} // namespace engine
@@ -0,0 +1,157 @@
+#include "watcher.hpp"
+
+#include <chrono>
+#include <vector>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace engine {
+
+Watcher::Watcher() noexcept
+{
+#if defined(__linux__)
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0 || pipe(wake_) != 0) {
+        return;
+    }
+#endif
+
+    thread_ = std::thread([this]() { work(); });
+}
+
+Watcher::~Watcher()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+
+    cv_.notify_all();
+
+#if defined(__linux__)
+    if (wake_[1] >= 0) {
+        [[maybe_unused]] auto written = write(wake_[1], "", 1);
+    }
+#endif
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+#if defined(__linux__)
+    for (i32 fd : {fd_, wake_[0], wake_[1]}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+void Watcher::watch(const string& path, callback_t callback) noexcept
+{
+    std::error_code error;
+    std::filesystem::path file = std::filesystem::absolute(path, error).lexically_normal();
+
+    std::lock_guard lock(mutex_);
+
+    auto time             = std::filesystem::last_write_time(file, error);
+    files_[file.string()] = File{.callback = std::move(callback), .time = time};
+
+#if defined(__linux__)
+    if (fd_ >= 0) {
+        i32 wd = inotify_add_watch(fd_, file.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd >= 0) {
+            dirs_[wd] = file.parent_path();
+        }
+    }
+#endif
+}
+
+#if defined(__linux__)
+
+void Watcher::work() noexcept
+{
+    alignas(inotify_event) char buffer[4096];
+
+    while (true) {
+        pollfd fds[] = {{.fd = fd_, .events = POLLIN, .revents = 0}, {.fd = wake_[0], .events = POLLIN, .revents = 0}};
+
+        if (poll(fds, 2, -1) < 0 || (fds[1].revents & POLLIN) != 0) {
+            return;
+        }
+
+        ssize_t length = read(fd_, buffer, sizeof(buffer));
+
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->len == 0) {
+                continue;
+            }
+
+            std::filesystem::path dir;
+            {
+                std::lock_guard lock(mutex_);
+                auto found = dirs_.find(event->wd);
+                if (found == dirs_.end()) {
+                    continue;
+                }
+                dir = found->second;
+            }
+
+            notify(dir / event->name);
+        }
+    }
+}
+
+#else
+
+void Watcher::work() noexcept
+{
+    std::unique_lock lock(mutex_);
+
+    while (!cv_.wait_for(lock, std::chrono::milliseconds(250), [this]() { return stop_; })) {
+        std::vector<std::filesystem::path> changed;
+
+        for (auto& [path, file] : files_) {
+            std::error_code error;
+            auto time = std::filesystem::last_write_time(path, error);
+
+            if (!error && time != file.time) {
+                file.time = time;
+                changed.push_back(path);
+            }
+        }
+
+        lock.unlock();
+        for (const std::filesystem::path& path : changed) {
+            notify(path);
+        }
+        lock.lock();
+    }
+}
+
+#endif
+
+void Watcher::notify(const std::filesystem::path& path) noexcept
+{
+    callback_t callback;
+
+    {
+        std::lock_guard lock(mutex_);
+        auto found = files_.find(path.string());
+        if (found == files_.end()) {
+            return;
+        }
+        callback = found->second.callback;
+    }
+
+    callback();
+}
+
+} // namespace engine
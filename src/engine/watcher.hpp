@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "defines.hpp"
+
+namespace engine {
+
+/*
+ * Calls back on a background thread when watched files are written. Directories of the files are
+ * watched rather than the files, since editors often save by replacing the file. Uses inotify on
+ * Linux and polls modification times elsewhere.
+ */
+class Watcher {
+public:
+    using callback_t = std::function<void()>;
+
+    Watcher() noexcept;
+
+    Watcher(const Watcher&)            = delete;
+    Watcher& operator=(const Watcher&) = delete;
+
+    ~Watcher();
+
+    void watch(const string& path, callback_t callback) noexcept;
+
+private:
+    struct File {
+        callback_t callback;
+        std::filesystem::file_time_type time;
+    };
+
+    void work() noexcept;
+
+    void notify(const std::filesystem::path& path) noexcept;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<string, File> files_;
+    std::unordered_map<i32, std::filesystem::path> dirs_;
+    i32 fd_{-1};
+    i32 wake_[2]{-1, -1};
+    bool stop_{false};
+    std::thread thread_;
+};
+
+} // namespace engine
@@ -0,0 +1,1077 @@
+#pragma once
+
+#include "fmt/format.h"
+// #include "box2d/box2d.h"
+#include "raylib.h"
+
+#include "engine/archetype.hpp"
+#include "engine/core.hpp"
+#include "engine/defines.hpp"
+#include "engine/ecs.hpp"
+#include "engine/mixer.hpp"
+#include "engine/overlay.hpp"
+#include "engine/names.hpp"
+#include "engine/profiling.hpp"
+#include "engine/render.hpp"
+#include "engine/resources.hpp"
+#include "engine/spatial.hpp"
+#include "engine/tilemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "config.hpp"
+
+namespace impl {
+
+namespace components {
+
+struct Camera {
+    Camera(engine::f32 zoom)
+        : zoom(zoom)
+    {
+    }
+
+    Camera() = default;
+
+    engine::f32 zoom{1.0f};
+};
+
+struct Transform {
+    Transform(engine::f32 x, engine::f32 y)
+        : pos(x, y)
+    {
+    }
+
+    Transform() = default;
+
+    engine::vec2 pos{0.0f, 0.0f};
+    engine::vec2 scale{1.0f, 1.0f};
+    engine::vec2 origin{0.0f, 0.0f};
+    engine::f32 rot{0.0f};
+};
+
+class TransformBuilder {
+public:
+    TransformBuilder& create()
+    {
+        t_ = Transform();
+        return *this;
+    }
+
+    TransformBuilder& position(engine::f32 x, engine::f32 y)
+    {
+        t_.pos.x = x;
+        t_.pos.y = y;
+        return *this;
+    }
+
+    TransformBuilder& scale(engine::f32 x, engine::f32 y)
+    {
+        t_.scale.x = x;
+        t_.scale.y = y;
+        return *this;
+    }
+
+    TransformBuilder& origin(engine::f32 x, engine::f32 y)
+    {
+        t_.origin.x = x;
+        t_.origin.y = y;
+        return *this;
+    }
+
+    TransformBuilder& rotation(engine::f32 r)
+    {
+        t_.rot = r;
+        return *this;
+    }
+
+    Transform build()
+    {
+        return t_;
+    }
+
+private:
+    Transform t_;
+};
+
+struct Text {
+    Text(engine::cstr text, engine::f32 size, engine::f32 hspacing, engine::f32 wspacing)
+        : text(text)
+        , size(size)
+        , hspacing(hspacing)
+        , wspacing(wspacing)
+    {
+    }
+
+    engine::cstr text{""};
+    engine::f32 size{0.0f};
+    engine::f32 hspacing{0.0f};
+    engine::f32 wspacing{0.0f};
+};
+
+struct Color {
+    Color(::Color color)
+        : color(color)
+    {
+    }
+
+    Color(engine::u8 r, engine::u8 g, engine::u8 b)
+        : color{r, g, b, 255}
+    {
+    }
+
+    ::Color color{};
+};
+
+/*
+ * Texture handle, owned by the sprite and released with it, and the source rectangle relative
+ * to the texture region; zero size stands for the whole region. The texture is looked up
+ * when drawn, so sprites follow reloads and evictions.
+ */
+struct Sprite {
+    engine::AssetId texture{};
+    engine::vec2 pos{0.0f, 0.0f};
+    engine::vec2 size{0.0f, 0.0f};
+    engine::i32 layer{0};
+};
+
+class SpriteBuilder {
+public:
+    SpriteBuilder& create()
+    {
+        s_ = Sprite();
+        return *this;
+    }
+
+    SpriteBuilder& texture(engine::AssetId texture)
+    {
+        s_.texture = texture;
+        return *this;
+    }
+
+    SpriteBuilder& position(engine::f32 x, engine::f32 y)
+    {
+        s_.pos.x = x;
+        s_.pos.y = y;
+        return *this;
+    }
+
+    SpriteBuilder& size(engine::f32 x, engine::f32 y)
+    {
+        s_.size.x = x;
+        s_.size.y = y;
+        return *this;
+    }
+
+    SpriteBuilder& layer(engine::i32 layer)
+    {
+        s_.layer = layer;
+        return *this;
+    }
+
+    Sprite build()
+    {
+        return s_;
+    }
+
+private:
+    Sprite s_;
+};
+
+struct Audio {
+    engine::AssetId music{};
+    bool playing{false};
+    engine::f32 volume{1.0f};
+    // position to jump to in seconds, negative for none, cleared once posted to the mixer
+    engine::f32 seek{-1.0f};
+    engine::MixerState posted{};
+};
+
+struct Player {};
+
+/*
+ * Position at the previous simulation tick, rendered blended with the current one
+ */
+struct Interpolated {
+    engine::vec2 last{0.0f, 0.0f};
+};
+
+/*
+ * World units per second
+ */
+struct Velocity {
+    engine::vec2 v{0.0f, 0.0f};
+};
+
+/*
+ * Index of the tilemap in the game's TilemapTable and handle of its tileset, both freed
+ * when the component goes away
+ */
+struct Tilemap {
+    engine::u32 map{0};
+    engine::AssetId tileset{};
+};
+
+struct Flags {
+    bool ui{false};
+    bool cell{false};
+};
+
+} // namespace components
+
+namespace game_preferenses {
+
+static const engine::f32 grid_size     = 10.0;
+static const engine::f32 cell_size     = RENDER_WIDTH / grid_size;
+static const engine::i32 atlas_size    = 1024;
+static const engine::f64 upload_budget = 0.002;
+static const size_t asset_budget       = 256 * 1024 * 1024;
+static const engine::f32 tick_rate     = 60.0f;
+
+}; // namespace game_preferenses
+
+using Entity = engine::ecs::Entity<
+    components::Camera,
+    components::Transform,
+    components::Color,
+    components::Text,
+    components::Player,
+    components::Interpolated,
+    components::Velocity,
+    components::Sprite,
+    components::Audio,
+    components::Flags,
+    components::Tilemap>;
+#if ARCHETYPE_STORAGE == 1
+using EntityStorage = engine::ecs::ArchetypeStorage<Entity>;
+#else
+using EntityStorage = engine::ecs::EntityStorage<Entity>;
+#endif
+using EntityBuilder = engine::ecs::EntityBuilder<Entity, EntityStorage>;
+using System        = engine::ecs::System<Entity, EntityStorage>;
+using SystemManager = engine::ecs::SystemManager<System>;
+using TextureHolder = engine::TextureHolder<engine::StringId>;
+using AudioHolder   = engine::AudioHolder<engine::StringId>;
+
+using namespace engine::literals;
+
+namespace game_utilities {
+
+inline Vector2 getMousePosition(EntityStorage& storage)
+{
+    const auto& [camera, transform] = storage.get<const components::Camera, const components::Transform>();
+
+    engine::vec2 mouse = engine::Platform::get()->mouse();
+
+    return GetScreenToWorld2D(
+        (Vector2){mouse.x, mouse.y},
+        (Camera2D){
+            .offset   = (Vector2){transform.origin.x, transform.origin.y},
+            .target   = (Vector2){transform.pos.x, transform.pos.y},
+            .rotation = transform.rot,
+            .zoom     = camera.zoom});
+}
+
+} // namespace game_utilities
+
+class DebugSystem : public System {
+public:
+    void setup(Storage& storage) noexcept override
+    {
+        EntityBuilder builder(storage);
+
+        builder.create()
+            .with<components::Flags>(components::Flags{.ui = true})
+            .with<components::Text>("Placeholder", 15.0, 1.0, 15.0)
+            .with<components::Color>(RED)
+            .with<components::Transform>(1.0f, 1.0f)
+            .build();
+    }
+
+    void update(Storage& storage) noexcept override
+    {
+        PROFILE_FUNCTION();
+
+        Stats stats{engine::Platform::get()->fps(), storage.active(), storage.size(), storage.memory()};
+
+        if (stats == stats_) {
+            return;
+        }
+
+        stats_ = stats;
+        fps_   = fmt::format(
+            "FPS: {}\n"
+            "Active: {}\n"
+            "All: {}\n"
+            "Memory: {:.2} MB\n",
+            stats.fps,
+            stats.active,
+            stats.size,
+            engine::f32(stats.memory) / 1024.0f / 1024.0f);
+
+        const auto& [text] = storage.get<components::Text>();
+        text.text          = fps_.data();
+    }
+
+    Access access() const noexcept override
+    {
+        return Access{.writes = components<components::Text>(), .main_thread = true, .exclusive = false};
+    }
+
+private:
+    struct Stats {
+        engine::i32 fps{0};
+        size_t active{0};
+        size_t size{0};
+        size_t memory{0};
+
+        bool operator==(const Stats&) const = default;
+    };
+
+    Stats stats_;
+    std::string fps_;
+};
+
+/*
+ * Remembers where interpolated entities were before the simulation moves them, added ahead
+ * of other fixed systems so it runs first in every step
+ */
+class InterpolationSystem : public System {
+public:
+    void setup(Storage&) noexcept override {}
+
+    void update(Storage& storage) noexcept override
+    {
+        PROFILE_FUNCTION();
+
+        auto iter = storage.iterator<components::Interpolated, const components::Transform>();
+
+        while (iter) {
+            const auto& [interpolated, transform] = *iter;
+            interpolated.last                     = transform.pos;
+
+            ++iter;
+        }
+    }
+
+    Access access() const noexcept override
+    {
+        return Access{
+            .reads       = components<components::Transform>(),
+            .writes      = components<components::Interpolated>(),
+            .main_thread = false,
+            .exclusive   = false,
+            .fixed       = true};
+    }
+};
+
+class PlayerSystem : public System {
+public:
+    PlayerSystem(TextureHolder& holder)
+        : holder_(holder)
+    {
+        engine::Platform::get()->hide_cursor();
+    }
+
+    void setup(Storage& storage) noexcept override
+    {
+        EntityBuilder builder(storage);
+
+        components::Transform transform =
+            components::TransformBuilder()
+                .create()
+                .scale(game_preferenses::cell_size, game_preferenses::cell_size)
+                .origin(0.5f * game_preferenses::cell_size, 0.5f * game_preferenses::cell_size)
+                .build();
+
+        builder.create()
+            .with<components::Flags>(components::Flags{.ui = false})
+            .with<components::Player>()
+            .with<components::Interpolated>(components::Interpolated{.last = transform.pos})
+            .with<components::Color>(WHITE)
+            .with<components::Transform>(transform)
+            .with<components::Sprite>(components::SpriteBuilder()
+                                          .create()
+                                          .texture(holder_.acquire("player"_sid))
+                                          .layer(1)
+                                          .build())
+            .build();
+    }
+
+    void update(Storage& storage) noexcept override
+    {
+        PROFILE_FUNCTION();
+
+        engine::f32 dt    = engine::Platform::get()->frame_time();
+        engine::f32 speed = 10.0f;
+
+        const auto& [player, ptransform] = storage.get<const components::Player, components::Transform>();
+
+        Vector2 pos = game_utilities::getMousePosition(storage);
+
+        // eases towards the mouse at the same pace whatever the tick rate is
+        engine::f32 t = 1.0f - std::exp(-speed * dt);
+        ptransform.pos.x += (pos.x - ptransform.pos.x) * t;
+        ptransform.pos.y += (pos.y - ptransform.pos.y) * t;
+    }
+
+    Access access() const noexcept override
+    {
+        return Access{
+            .reads       = components<components::Player, components::Camera>(),
+            .writes      = components<components::Transform>(),
+            .main_thread = true,
+            .exclusive   = false,
+            .fixed       = true};
+    }
+
+private:
+    TextureHolder& holder_;
+};
+
+/*
+ * Sprites drifting over the grid and bouncing off its edges, the load the benchmark scales
+ */
+class CrowdSystem : public System {
+public:
+    CrowdSystem(TextureHolder& holder, engine::u32 grid, size_t count)
+        : holder_(holder)
+        , half_(grid * game_preferenses::cell_size / 2.0f)
+        , count_(count)
+    {
+    }
+
+    void setup(Storage& storage) noexcept override
+    {
+        EntityBuilder builder(storage);
+
+        // fixed seed, so runs are comparable
+        std::mt19937 random(42);
+        std::uniform_real_distribution<engine::f32> position(-half_, half_);
+        std::uniform_real_distribution<engine::f32> speed(-game_preferenses::cell_size, game_preferenses::cell_size);
+        engine::f32 size = game_preferenses::cell_size / 4.0f;
+
+        for (size_t i = 0; i < count_; ++i) {
+            components::Transform transform = components::TransformBuilder()
+                                                  .create()
+                                                  .position(position(random), position(random))
+                                                  .scale(size, size)
+                                                  .origin(size / 2.0f, size / 2.0f)
+                                                  .build();
+
+            builder.create()
+                .with<components::Flags>(components::Flags{.ui = false})
+                .with<components::Interpolated>(components::Interpolated{.last = transform.pos})
+                .with<components::Velocity>(components::Velocity{.v = engine::vec2(speed(random), speed(random))})
+                .with<components::Color>(WHITE)
+                .with<components::Transform>(transform)
+                .with<components::Sprite>(
+                    components::SpriteBuilder().create().texture(holder_.acquire("cell"_sid)).build())
+                .build();
+        }
+    }
+
+    void update(Storage& storage) noexcept override
+    {
+        PROFILE_FUNCTION();
+
+        engine::f32 dt   = engine::Platform::get()->frame_time();
+        engine::f32 half = half_;
+
+        storage.parallel_for_each<components::Transform, components::Velocity>(
+            [dt, half](components::Transform& transform, components::Velocity& velocity) {
+                transform.pos.x += velocity.v.x * dt;
+                transform.pos.y += velocity.v.y * dt;
+
+                if (std::abs(transform.pos.x) > half) {
+                    velocity.v.x = -velocity.v.x;
+                }
+                if (std::abs(transform.pos.y) > half) {
+                    velocity.v.y = -velocity.v.y;
+                }
+            });
+    }
+
+    Access access() const noexcept override
+    {
+        return Access{
+            .writes      = components<components::Transform, components::Velocity>(),
+            .main_thread = false,
+            .exclusive   = false,
+            .fixed       = true};
+    }
+
+private:
+    TextureHolder& holder_;
+    engine::f32 half_{0.0f};
+    size_t count_{0};
+};
+
+class CellSystem : public System {
+public:
+    CellSystem(TextureHolder& holder, engine::TilemapTable& tilemaps, engine::u32 grid)
+        : holder_(holder)
+        , tilemaps_(tilemaps)
+        , grid_(grid)
+    {
+    }
+
+    void setup(Storage& storage) noexcept override
+    {
+        storage.on_remove<components::Tilemap>([this, &storage](engine::ecs::EntityId id) {
+            const auto& [tilemap] = storage.get<const components::Tilemap>(id);
+            tilemaps_.erase(tilemap.map);
+            holder_.release(tilemap.tileset);
+        });
+
+        EntityBuilder builder(storage);
+
+        engine::AssetId tileset = holder_.acquire("cell"_sid);
+        engine::i32 tile_px     = std::max(static_cast<engine::i32>(holder_.get(tileset).rect.width), 1);
+
+        auto map = std::make_unique<engine::Tilemap>(tile_px, game_preferenses::cell_size, grid_, grid_);
+
+        for (engine::u32 i = 0; i < grid_; ++i) {
+            for (engine::u32 j = 0; j < grid_; ++j) {
+                map->set(i, j, engine::Tile{.index = 0});
+            }
+        }
+
+        engine::f32 corner = -(grid_ * game_preferenses::cell_size / 2.0f);
+
+        builder.create()
+            .with<components::Flags>(components::Flags{.ui = false, .cell = true})
+            .with<components::Transform>(components::TransformBuilder().create().position(corner, corner).build())
+            .with<components::Tilemap>(components::Tilemap{.map = tilemaps_.insert(std::move(map)), .tileset = tileset})
+            .build();
+    }
+
+    void update(Storage&) noexcept override {}
+
+    Access access() const noexcept override
+    {
+        return Access{.main_thread = false, .exclusive = false};
+    }
+
+private:
+    TextureHolder& holder_;
+    engine::TilemapTable& tilemaps_;
+    engine::u32 grid_{0};
+};
+
+class RenderSystem : public System {
+public:
+    RenderSystem(
+        engine::u32 w,
+        engine::u32 h,
+        engine::f32 view,
+        TextureHolder& textures,
+        engine::TilemapTable& tilemaps,
+        engine::ProfilerOverlay& overlay)
+        : w_(w)
+        , h_(h)
+        , view_(view)
+        , textures_(textures)
+        , tilemaps_(tilemaps)
+        , overlay_(overlay)
+    {
+    }
+
+    void setup(Storage& storage) noexcept override
+    {
+        // an entity that stops matching the sprite query leaves the index right away, wherever it is
+        auto drop = [this](engine::ecs::EntityId id) { grid_.erase(id); };
+
+        storage.on_remove<components::Sprite>([this, &storage](engine::ecs::EntityId id) {
+            const auto& [sprite] = storage.get<const components::Sprite>(id);
+            textures_.release(sprite.texture);
+            grid_.erase(id);
+        });
+        storage.on_remove<components::Transform>(drop);
+        storage.on_remove<components::Color>(drop);
+        storage.on_remove<components::Flags>(drop);
+
+        EntityBuilder builder(storage);
+
+        builder.create()
+            .with<components::Camera>(h_ / 2.0f / view_)
+            .with<components::Transform>(components::TransformBuilder().create().origin(w_ / 4.0f, h_ / 4.0f).build())
+            .build();
+    }
+
+    void update(Storage& storage) noexcept override
+    {
+        PROFILE_FUNCTION();
+
+        // nothing to draw into without a window, the spatial index is still kept up to date
+        if (engine::Platform::get()->headless()) {
+            index(storage);
+            return;
+        }
+
+        const auto& [camera, transform] = storage.get<const components::Camera, const components::Transform>();
+        Camera2D view{
+            .offset   = (Vector2){transform.origin.x, transform.origin.y},
+            .target   = (Vector2){transform.pos.x, transform.pos.y},
+            .rotation = transform.rot,
+            .zoom     = camera.zoom};
+        Rectangle area = visible_area(view);
+
+        // chunk textures have to be refreshed before the camera transform is set up
+        tilemaps(storage, area, false);
+
+        BeginDrawing();
+        ClearBackground(Color{.r = 42, .g = 35, .b = 73, .a = 255});
+
+        texures(storage);
+        text(storage, true);
+
+        BeginMode2D(view);
+
+        tilemaps(storage, area, true);
+        visible(storage, area);
+        text(storage, false);
+
+        EndMode2D();
+
+        overlay_.draw(w_ - 500, 10);
+
+        EndDrawing();
+    }
+
+    Access access() const noexcept override
+    {
+        return Access{
+            .reads = components<
+                components::Camera,
+                components::Transform,
+                components::Sprite,
+                components::Text,
+                components::Color,
+                components::Flags,
+                components::Tilemap,
+                components::Interpolated>(),
+            .main_thread = true,
+            .exclusive   = false};
+    }
+
+private:
+    /*
+     * Sprite in the spatial index, its texture is looked up when it is drawn
+     */
+    struct Indexed {
+        components::Sprite sprite;
+        engine::DrawCommand command;
+    };
+
+    void text(Storage& storage, bool ui)
+    {
+        PROFILE_FUNCTION();
+
+        auto text_iter = storage.iterator<
+            const components::Text,
+            const components::Transform,
+            const components::Color,
+            const components::Flags>();
+
+        while (text_iter) {
+            const auto& [text, transform, color, flags] = *text_iter;
+
+            if (flags.ui == ui) {
+                SetTextLineSpacing(text.wspacing);
+                DrawTextPro(
+                    GetFontDefault(),
+                    text.text,
+                    (Vector2){transform.pos.x, transform.pos.y},
+                    (Vector2){transform.origin.x, transform.origin.y},
+                    transform.rot,
+                    text.size,
+                    text.hspacing,
+                    color.color);
+            }
+
+            ++text_iter;
+        }
+    }
+
+    void texures(Storage& storage)
+    {
+        PROFILE_FUNCTION();
+
+        auto texures_iter = storage.iterator<
+            const components::Sprite,
+            const components::Transform,
+            const components::Color,
+            const components::Flags>();
+
+        queue_.clear();
+
+        while (texures_iter) {
+            const auto& [sprite, transform, color, flags] = *texures_iter;
+
+            if (flags.ui) {
+                push(sprite, command(sprite, transform, color));
+            }
+
+            ++texures_iter;
+        }
+
+        queue_.submit();
+    }
+
+    /*
+     * Refreshes dirty chunks of tilemaps in the area, or draws them
+     */
+    void tilemaps(Storage& storage, Rectangle area, bool draw)
+    {
+        PROFILE_FUNCTION();
+
+        auto tilemap_iter = storage.iterator<const components::Tilemap, const components::Transform>();
+
+        while (tilemap_iter) {
+            const auto& [tilemap, transform] = *tilemap_iter;
+            Vector2 origin{transform.pos.x, transform.pos.y};
+            engine::rptr<engine::Tilemap> map = tilemaps_.get(tilemap.map);
+
+            if (map != nullptr && draw) {
+                map->draw(origin, area);
+            }
+            else if (map != nullptr) {
+                map->render(origin, area, textures_.get(tilemap.tileset), textures_.revision(tilemap.tileset));
+            }
+
+            ++tilemap_iter;
+        }
+    }
+
+    /*
+     * World-space box seen through the camera
+     */
+    Rectangle visible_area(const Camera2D& view) const
+    {
+        Vector2 corners[] = {
+            GetScreenToWorld2D((Vector2){0.0f, 0.0f}, view),
+            GetScreenToWorld2D((Vector2){engine::f32(w_), 0.0f}, view),
+            GetScreenToWorld2D((Vector2){0.0f, engine::f32(h_)}, view),
+            GetScreenToWorld2D((Vector2){engine::f32(w_), engine::f32(h_)}, view)};
+
+        Rectangle area{corners[0].x, corners[0].y, 0.0f, 0.0f};
+        for (const Vector2& corner : corners) {
+            area = bounds(area, corner);
+        }
+
+        return area;
+    }
+
+    /*
+     * Draws world sprites intersecting the area, looked up in the spatial index
+     */
+    void visible(Storage& storage, Rectangle area)
+    {
+        PROFILE_FUNCTION();
+
+        index(storage);
+
+        queue_.clear();
+
+        grid_.query(
+            area, [this](engine::ecs::EntityId, const Indexed& indexed) { push(indexed.sprite, indexed.command); });
+
+        queue_.submit();
+    }
+
+    /*
+     * Brings the spatial index up to date with sprites changed since the last update
+     */
+    void index(Storage& storage)
+    {
+        PROFILE_FUNCTION();
+
+        sync(storage);
+        interpolate(storage);
+    }
+
+    /*
+     * Places sprites moved by the simulation between their last two ticks, by the alpha of the frame
+     */
+    void interpolate(Storage& storage)
+    {
+        engine::f32 alpha = engine::Platform::get()->alpha();
+
+        auto iter = storage.iterator<
+            const components::Interpolated,
+            const components::Sprite,
+            const components::Transform,
+            const components::Color,
+            const components::Flags>();
+
+        while (iter) {
+            const auto& [interpolated, sprite, transform, color, flags] = *iter;
+
+            if (!flags.ui) {
+                components::Transform blended = transform;
+
+                blended.pos.x = interpolated.last.x + (transform.pos.x - interpolated.last.x) * alpha;
+                blended.pos.y = interpolated.last.y + (transform.pos.y - interpolated.last.y) * alpha;
+
+                grid_.insert(iter.id(), bounds(blended), Indexed{sprite, command(sprite, blended, color)});
+            }
+
+            ++iter;
+        }
+    }
+
+    /*
+     * One pass over sprites with any of their components changed, removed ones are dropped by the hooks
+     */
+    void sync(Storage& storage)
+    {
+        auto iter = storage.iterator<
+            const components::Sprite,
+            const components::Transform,
+            const components::Color,
+            const components::Flags>(
+            engine::ecs::AnyChanged<components::Sprite, components::Transform, components::Color, components::Flags>{
+                since()});
+
+        while (iter) {
+            const auto& [sprite, transform, color, flags] = *iter;
+
+            if (flags.ui) {
+                grid_.erase(iter.id());
+            }
+            else {
+                grid_.insert(iter.id(), bounds(transform), Indexed{sprite, command(sprite, transform, color)});
+            }
+
+            ++iter;
+        }
+    }
+
+    /*
+     * Queues the command with the texture of the sprite as it is now, sprites with unloaded
+     * or stale textures are skipped
+     */
+    void push(const components::Sprite& sprite, engine::DrawCommand command)
+    {
+        const engine::Region& region = textures_.get(sprite.texture);
+
+        if (region.texture.id == 0) {
+            return;
+        }
+
+        command.texture = region.texture;
+        command.source  = Rectangle{
+            region.rect.x + sprite.pos.x,
+            region.rect.y + sprite.pos.y,
+            sprite.size.x != 0.0f ? sprite.size.x : region.rect.width,
+            sprite.size.y != 0.0f ? sprite.size.y : region.rect.height};
+
+        queue_.push(command);
+    }
+
+    /*
+     * Everything but the texture and the source rectangle, which push() looks up
+     */
+    static engine::DrawCommand command(
+        const components::Sprite& sprite,
+        const components::Transform& transform,
+        const components::Color& color)
+    {
+        return engine::DrawCommand{
+            .layer    = sprite.layer,
+            .dest     = (Rectangle){transform.pos.x, transform.pos.y, transform.scale.x, transform.scale.y},
+            .origin   = (Vector2){transform.origin.x, transform.origin.y},
+            .rotation = transform.rot,
+            .tint     = color.color};
+    }
+
+    /*
+     * World-space box of a sprite drawn with DrawTexturePro, rotated sprites get the box of
+     * the circle they sweep around pos
+     */
+    static Rectangle bounds(const components::Transform& transform)
+    {
+        engine::vec2 min(-transform.origin.x, -transform.origin.y);
+        engine::vec2 max(transform.scale.x - transform.origin.x, transform.scale.y - transform.origin.y);
+
+        if (transform.rot != 0.0f) {
+            engine::f32 r = std::hypot(
+                std::max(std::abs(min.x), std::abs(max.x)), std::max(std::abs(min.y), std::abs(max.y)));
+            min = engine::vec2(-r, -r);
+            max = engine::vec2(r, r);
+        }
+
+        return Rectangle{transform.pos.x + min.x, transform.pos.y + min.y, max.x - min.x, max.y - min.y};
+    }
+
+    static Rectangle bounds(Rectangle area, Vector2 point)
+    {
+        engine::f32 x0 = std::min(area.x, point.x);
+        engine::f32 y0 = std::min(area.y, point.y);
+        engine::f32 x1 = std::max(area.x + area.width, point.x);
+        engine::f32 y1 = std::max(area.y + area.height, point.y);
+
+        return Rectangle{x0, y0, x1 - x0, y1 - y0};
+    }
+
+    engine::u32 w_{0};
+    engine::u32 h_{0};
+    engine::f32 view_{0};
+    TextureHolder& textures_;
+    engine::TilemapTable& tilemaps_;
+    engine::ProfilerOverlay& overlay_;
+    engine::RenderQueue queue_;
+    engine::SpatialGrid<Indexed> grid_{4.0f * game_preferenses::cell_size};
+};
+
+class AudioSystem : public System {
+public:
+    AudioSystem(AudioHolder& holder)
+        : holder_(holder)
+        , music_(holder.acquire("piano"_sid))
+    {
+    }
+
+    ~AudioSystem() override
+    {
+        holder_.release(music_);
+    }
+
+    void setup(Storage& storage) noexcept override
+    {
+        EntityBuilder builder(storage);
+
+        builder.create().with<components::Audio>(components::Audio{.music = music_, .playing = true}).build();
+    }
+
+    void update(Storage& storage) noexcept override
+    {
+        PROFILE_FUNCTION();
+
+        auto audio_iter = storage.iterator<components::Audio>();
+
+        while (audio_iter) {
+            const auto& [audio] = *audio_iter;
+
+            // looked up every frame, so a reloaded stream is picked up; only changes reach the mixer
+            const engine::Music& music = holder_.get(audio.music);
+            engine::Mixer::get()->apply(audio.posted, music, audio.playing, audio.volume);
+
+            if (audio.seek >= 0.0f) {
+                engine::Mixer::get()->seek(music, audio.seek);
+                audio.seek = -1.0f;
+            }
+
+            ++audio_iter;
+        }
+    }
+
+    Access access() const noexcept override
+    {
+        return Access{.writes = components<components::Audio>(), .main_thread = true, .exclusive = false};
+    }
+
+private:
+    AudioHolder& holder_;
+    engine::AssetId music_;
+};
+
+class Game : public engine::Game {
+public:
+    Game()
+        : engine::Game("You Not Gonna Sleep Well Today")
+    {
+    }
+
+    Game(engine::i32 width, engine::i32 height, engine::u32 grid, size_t crowd = 0)
+        : engine::Game(width, height, "You Not Gonna Sleep Well Today")
+        , grid_(grid)
+        , crowd_(crowd)
+    {
+    }
+
+    void setup() noexcept override
+    {
+        PROFILE_FUNCTION();
+
+#if HOT_RELOAD == 1
+        textures_.watch();
+        audio_.watch();
+#endif
+
+        textures_.budget(game_preferenses::asset_budget);
+        audio_.budget(game_preferenses::asset_budget);
+
+        // assets decode in the background while the window and audio device come up
+        engine::LoadHandle cell  = textures_.load_async("cell.png", "cell"_sid);
+        engine::LoadHandle cross = textures_.load_async("cross.png", "player"_sid);
+        engine::LoadHandle piano = audio_.load_async("music.mp3", "piano"_sid);
+
+        engine::Game::setup();
+
+        textures_.wait(cell);
+        textures_.wait(cross);
+        audio_.wait(piano);
+
+        manager_.add(std::make_unique<InterpolationSystem>());
+        manager_.add(std::make_unique<RenderSystem>(width(), height(), RENDER_WIDTH, textures_, tilemaps_, overlay_));
+        manager_.add(std::make_unique<CellSystem>(textures_, tilemaps_, grid_));
+        manager_.add(std::make_unique<PlayerSystem>(textures_));
+        manager_.add(std::make_unique<CrowdSystem>(textures_, grid_, crowd_));
+        manager_.add(std::make_unique<AudioSystem>(audio_));
+        manager_.add(std::make_unique<DebugSystem>());
+    }
+
+    void step() noexcept override
+    {
+        PROFILE_FUNCTION();
+
+        manager_.step();
+    }
+
+    void update() noexcept override
+    {
+        PROFILE_FUNCTION();
+
+        textures_.upload(game_preferenses::upload_budget);
+        audio_.upload(game_preferenses::upload_budget);
+
+        manager_.update();
+
+        if (engine::Platform::get()->key_pressed(KEY_ESCAPE)) {
+            exit();
+        }
+
+#if PROFILING == 1
+        if (engine::Platform::get()->key_pressed(KEY_F3)) {
+            overlay_.toggle();
+        }
+
+        if (engine::Platform::get()->key_pressed(KEY_F2)) {
+            engine::AutomaticProfilerRegister::get()->trace("trace.json");
+        }
+#endif
+    }
+
+    void shutdown() noexcept override
+    {
+        PROFILE_FUNCTION();
+
+        engine::Game::shutdown();
+    }
+
+private:
+    engine::u32 grid_{static_cast<engine::u32>(game_preferenses::grid_size)};
+    size_t crowd_{0};
+    engine::Filesystem fs_{RESOURCES_PATH, "content.pak"};
+    // systems release their assets on destruction, so holders have to outlive them
+    TextureHolder textures_{fs_, game_preferenses::atlas_size};
+    AudioHolder audio_{fs_};
+    engine::TilemapTable tilemaps_;
+    engine::ProfilerOverlay overlay_;
+    SystemManager manager_;
+};
+} // namespace impl
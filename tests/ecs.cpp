@@ -0,0 +1,117 @@
+#include <iostream>
+
+#include "../src/engine/archetype.hpp"
+#include "../src/engine/ecs.hpp"
+
+/*
+ * Change detection under parallel scheduling: two systems without shared components run side
+ * by side, each writes its own component and must not report its own writes as changes on the
+ * next update. Exits with 1 when it does.
+ */
+
+namespace {
+
+struct Position {
+    engine::f32 x{0.0f};
+};
+
+struct Velocity {
+    engine::f32 x{0.0f};
+};
+
+using Entity = engine::ecs::Entity<Position, Velocity>;
+
+constexpr size_t entities = 100;
+constexpr size_t updates  = 20;
+
+template <typename Storage, typename Component>
+class Writer : public engine::ecs::System<Entity, Storage> {
+public:
+    using Base   = engine::ecs::System<Entity, Storage>;
+    using Access = typename Base::Access;
+
+    Writer(size_t& seen)
+        : seen_(seen)
+    {
+    }
+
+    void setup(Storage& storage) noexcept override
+    {
+        engine::ecs::EntityBuilder<Entity, Storage> builder(storage);
+
+        for (size_t i = 0; i < entities; ++i) {
+            builder.create().template with<Component>().build();
+        }
+    }
+
+    void update(Storage& storage) noexcept override
+    {
+        size_t seen  = 0;
+        auto changed = storage.template iterator<const Component>(engine::ecs::Changed<Component>{this->since()});
+        while (changed) {
+            ++seen;
+            ++changed;
+        }
+
+        // the first update sees components added during setup
+        if (!first_) {
+            seen_ += seen;
+        }
+        first_ = false;
+
+        // what the other system starting meanwhile does, done here so a pool without workers,
+        // which runs the systems one after another, still moves the tick past this start
+        storage.advance();
+
+        auto iter = storage.template iterator<Component>();
+        while (iter) {
+            auto [component] = *iter;
+            component.x += 1.0f;
+            ++iter;
+        }
+    }
+
+    Access access() const noexcept override
+    {
+        return Access{.writes = Base::template components<Component>(), .main_thread = false, .exclusive = false};
+    }
+
+private:
+    size_t& seen_;
+    bool first_{true};
+};
+
+template <typename Storage>
+bool own_writes_unseen(engine::cstr name)
+{
+    using System = engine::ecs::System<Entity, Storage>;
+
+    size_t positions  = 0;
+    size_t velocities = 0;
+
+    engine::ecs::SystemManager<System> manager;
+    manager.add(std::make_unique<Writer<Storage, Position>>(positions));
+    manager.add(std::make_unique<Writer<Storage, Velocity>>(velocities));
+
+    for (size_t i = 0; i < updates; ++i) {
+        manager.update();
+    }
+
+    bool ok = positions == 0 && velocities == 0;
+    std::cout << (ok ? "ok  " : "FAIL") << " : " << name << ", own writes seen as changes: " << positions
+              << " positions, " << velocities << " velocities" << std::endl;
+
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    bool ok = true;
+
+    ok = own_writes_unseen<engine::ecs::EntityStorage<Entity>>("entity storage") && ok;
+    ok = own_writes_unseen<engine::ecs::ArchetypeStorage<Entity>>("archetype storage") && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include "../src/engine/archive.hpp"
+
+/*
+ * Packs every file under a directory into an archive served by engine::Filesystem
+ *
+ * Usage: pack [-z] <root> <archive>
+ */
+
+int main(int argc, char** argv)
+{
+    bool compress = argc > 1 && std::strcmp(argv[1], "-z") == 0;
+    int first     = compress ? 2 : 1;
+
+    if (argc - first != 2) {
+        std::cerr << "Usage: pack [-z] <root> <archive>" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path root   = argv[first];
+    std::filesystem::path output = std::filesystem::absolute(argv[first + 1]);
+
+    std::vector<engine::string> files;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root)) {
+        if (entry.is_regular_file() && std::filesystem::absolute(entry.path()) != output) {
+            files.push_back(std::filesystem::relative(entry.path(), root).generic_string());
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+
+    if (!engine::Archive::write(root.string(), files, output.string(), compress)) {
+        std::cerr << "Failed to write " << output.string() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Packed " << files.size() << " files into " << output.string() << std::endl;
+
+    return 0;
+}